@@ -70,62 +70,50 @@
 </beSTORM>\n\
 "
 
-static int indent(FILE * o, unsigned depth)
-{
-	assert(o);
-	while (depth--)
-		if (fputc('\t', o) != '\t')
-			return -1;
-	return 0;
-}
-
-static int comment(FILE * o, unsigned depth, const char *fmt, ...)
+static int comment(writer_t *o, unsigned depth, const char *fmt, ...)
 {
 	assert(o);
 	assert(fmt);
 	va_list args;
 	assert(o && fmt);
-	errno = 0;
-	if (indent(o, depth) < 0)
-		goto warn;
-	if (fputs("<!-- ", o) < 0)
-		goto warn;
+	if (writer_indent(o, depth) < 0)
+		goto fail;
+	if (writer_puts(o, "<!-- ") < 0)
+		goto fail;
 	assert(fmt);
 	va_start(args, fmt);
-	int r = vfprintf(o, fmt, args);
+	int r = writer_vprintf(o, fmt, args);
 	va_end(args);
 	if (r < 0)
-		goto warn;
-	if (fputs(" -->\n", o) < 0)
-		goto warn;
+		goto fail;
+	if (writer_puts(o, " -->\n") < 0)
+		goto fail;
 	return 0;
- warn:
-	warning("XML comment generation, problem writing to FILE* <%p>: %s", o,
-		emsg());
+ fail:
 	return -1;
 }
 
-static int signal2bsm(signal_t * sig, FILE * o, unsigned depth)
+static int signal2bsm(signal_t * sig, writer_t *o, unsigned depth)
 {
 	assert(sig);
 	assert(o);
 	UNUSED(depth);
 
 	if (sig->bit_length > 16) { /* We need to split it into two, because we assume a <BB> is a 16 bit element (0xXX 0x00) */
-		fprintf(o, "\t\t\t\t\t\t\t\t\t<BB Name=\"%s (LSB)\" Bits=\"0\" Size=\"%d\" />\n", sig->name, 16);
-		fprintf(o, "\t\t\t\t\t\t\t\t\t<BB Name=\"%s (MSB)\" Bits=\"0\" Size=\"%d\" />\n", sig->name, sig->bit_length - 16);
+		writer_printf(o, "\t\t\t\t\t\t\t\t\t<BB Name=\"%s (LSB)\" Bits=\"0\" Size=\"%d\" />\n", sig->name, 16);
+		writer_printf(o, "\t\t\t\t\t\t\t\t\t<BB Name=\"%s (MSB)\" Bits=\"0\" Size=\"%d\" />\n", sig->name, sig->bit_length - 16);
 } else {
-		fprintf(o, "\t\t\t\t\t\t\t\t\t<BB Name=\"%s\" Bits=\"0\" Size=\"%d\" />\n", sig->name, sig->bit_length);
+		writer_printf(o, "\t\t\t\t\t\t\t\t\t<BB Name=\"%s\" Bits=\"0\" Size=\"%d\" />\n", sig->name, sig->bit_length);
 	}
 
 	return 0;
 }
 
-static int msg2bsm(can_msg_t * msg, FILE * o, unsigned depth)
+static int msg2bsm(can_msg_t * msg, writer_t *o, unsigned depth)
 {
 	assert(msg);
 	assert(o);
-	indent(o, depth);
+	writer_indent(o, depth);
 
 	unsigned last_bit = 0;	/* Detect gaps between signals */
 
@@ -154,7 +142,7 @@ static int msg2bsm(can_msg_t * msg, FILE * o, unsigned depth)
 		padding_size = 32;
 	}
 
-	fprintf(o, BSM_MESSAGE_PREFIX, msg->name, msg->id, msg->id, padding_size);
+	writer_printf(o, BSM_MESSAGE_PREFIX, msg->name, msg->id, msg->id, padding_size);
 
 	last_bit = 0;
 	signal_t *multiplexor = NULL;
@@ -191,12 +179,12 @@ static int msg2bsm(can_msg_t * msg, FILE * o, unsigned depth)
 
 		last_bit = sig->start_bit + sig->bit_length;
 	}
-	if (fprintf(o, BSM_MESSAGE_SUFFIX) < 0)
+	if (writer_puts(o, BSM_MESSAGE_SUFFIX) < 0)
 		return -1;
 	return 0;
 }
 
-int dbc2bsm(dbc_t * dbc, FILE * output, bool use_time_stamps)
+int dbc2bsm(dbc_t * dbc, writer_t *output, bool use_time_stamps)
 {
 	assert(dbc);
 	assert(output);
@@ -204,7 +192,7 @@ int dbc2bsm(dbc_t * dbc, FILE * output, bool use_time_stamps)
 	struct tm *timeinfo = localtime(&rawtime);
 
 	comment(output, 0, "Generated by dbcc (see https://github.com/howerj/dbcc)");
-	fprintf(output, BSM_PREFIX);
+	writer_puts(output, BSM_PREFIX);
 
 	if (use_time_stamps)
 		comment(output, 0, "Generated on: %s", asctime(timeinfo));
@@ -215,7 +203,7 @@ int dbc2bsm(dbc_t * dbc, FILE * output, bool use_time_stamps)
 		}
 	}
 
-	fprintf(output, BSM_SUFFIX);
+	writer_puts(output, BSM_SUFFIX);
 
 	return 0;
 }
@@ -6,8 +6,9 @@ extern "C" {
 #endif
 
 #include "can.h"
+#include "writer.h"
 
-int dbc2bsm(dbc_t *dbc, FILE *output, bool use_time_stamps);
+int dbc2bsm(dbc_t *dbc, writer_t *output, bool use_time_stamps);
 
 #ifdef __cplusplus
 }
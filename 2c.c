@@ -14,11 +14,14 @@
 #include "util.h"
 #include <assert.h>
 #include <ctype.h>
+#include <float.h>
 #include <inttypes.h>
+#include <math.h>
 #include <string.h>
 #include <time.h>
 
 #define MAX_NAME_LENGTH (512u)
+#define MAX_CONSTANT_LENGTH (64u)
 
 /* The float packing and unpacking is stolen and modified from
  * <https://beej.us/guide/bgnet/examples/pack2b.c>!
@@ -36,12 +39,32 @@
  * All Exponent Bits Set
  * - Mantissa is zero and sign bit is zero ->  Infinity
  * - Mantissa is zero and sign bit is on   -> -Infinity
- * - Mantissa is non-zero -> NaN */
-
+ * - Mantissa is non-zero -> NaN
+ *
+ * If 'float' and 'double' are IEEE-754 binary32 and binary64, which is
+ * detected from <float.h> when the generated code is compiled, the portable
+ * versions are not used and the bits are copied with 'memcpy', which
+ * compilers turn into a register move. The portable versions loop once per
+ * power of two in the exponent, hundreds of times for very large or small
+ * numbers. Defining DBCC_IEEE754 as 0 or 1 overrides the detection. */
+
+static const char *float_detect = "\
+#ifndef DBCC_IEEE754 /* are float and double IEEE-754 binary32 and binary64? */\n\
+#if FLT_RADIX == 2 && FLT_MANT_DIG == 24 && FLT_MAX_EXP == 128 && DBL_MANT_DIG == 53 && DBL_MAX_EXP == 1024\n\
+#define DBCC_IEEE754 (1)\n\
+#else\n\
+#define DBCC_IEEE754 (0)\n\
+#endif\n\
+#endif\n\
+\n";
 
 static char *float_pack = "\
+#if DBCC_IEEE754\n\
+static inline uint32_t pack754_32(const float f)  { uint32_t i; memcpy(&i, &f, sizeof i); return i; }\n\
+static inline uint64_t pack754_64(const double f) { uint64_t i; memcpy(&i, &f, sizeof i); return i; }\n\
+#else\n\
 /* pack754() -- pack a floating point number into IEEE-754 format */ \n\
-static uint64_t pack754(const double f, const unsigned bits, const unsigned expbits) {\n\
+static inline uint64_t pack754(const double f, const unsigned bits, const unsigned expbits) {\n\
 	if (f == 0.0) /* get this special case out of the way */\n\
 		return signbit(f) ? (1uLL << (bits - 1)) :  0;\n\
 	if (f != f) /* NaN, encoded as Exponent == all-bits-set, Mantissa != 0, Signbit == Do not care */\n\
@@ -76,11 +99,16 @@ static uint64_t pack754(const double f, const unsigned bits, const unsigned expb
 \n\
 static inline uint32_t   pack754_32(const float  f)   { return   pack754(f, 32, 8); }\n\
 static inline uint64_t   pack754_64(const double f)   { return   pack754(f, 64, 11); }\n\
+#endif\n\
 \n\n";
 
 static char *float_unpack = "\
+#if DBCC_IEEE754\n\
+static inline float  unpack754_32(uint32_t i) { float f;  memcpy(&f, &i, sizeof f); return f; }\n\
+static inline double unpack754_64(uint64_t i) { double f; memcpy(&f, &i, sizeof f); return f; }\n\
+#else\n\
 /* unpack754() -- unpack a floating point number from IEEE-754 format */ \n\
-static double unpack754(const uint64_t i, const unsigned bits, const unsigned expbits) {\n\
+static inline double unpack754(const uint64_t i, const unsigned bits, const unsigned expbits) {\n\
 	if (i == 0) return 0.0;\n\
 \n\
 	const uint64_t expset = ((1uLL << expbits) - 1uLL) << (bits - expbits - 1);\n\
@@ -107,6 +135,7 @@ static double unpack754(const uint64_t i, const unsigned bits, const unsigned ex
 \n\
 static inline float    unpack754_32(uint32_t i) { return unpack754(i, 32, 8); }\n\
 static inline double   unpack754_64(uint64_t i) { return unpack754(i, 64, 11); }\n\
+#endif\n\
 \n\n";
 
 
@@ -153,100 +182,280 @@ static const char *determine_type(unsigned length, bool is_signed, bool is_float
 		determine_unsigned_type(length);
 }
 
-static int comment(signal_t *sig, FILE *o, const char *indent)
+static int comment(signal_t *sig, writer_t *o, const char *indent)
 {
 	assert(sig);
 	assert(o);
-	return fprintf(o, "%s/* %s: start-bit %u, length %u, endianess %s, scaling %g, offset %g */\n",
-			indent,
-			sig->name,
-			sig->start_bit,
-			sig->bit_length,
-			sig->endianess == endianess_motorola_e ? "motorola" : "intel",
-			sig->scaling,
-			sig->offset);
+	/* called for every signal twice, so this avoids printf */
+	writer_puts(o, indent);
+	writer_puts(o, "/* ");
+	writer_puts(o, sig->name);
+	writer_puts(o, ": start-bit ");
+	writer_unsigned(o, sig->start_bit);
+	writer_puts(o, ", length ");
+	writer_unsigned(o, sig->bit_length);
+	writer_puts(o, ", endianess ");
+	writer_puts(o, sig->endianess == endianess_motorola_e ? "motorola" : "intel");
+	writer_puts(o, ", scaling ");
+	writer_double(o, sig->scaling);
+	writer_puts(o, ", offset ");
+	writer_double(o, sig->offset);
+	return writer_puts(o, " */\n");
 }
 
-static int signal2deserializer(signal_t *sig, const char *msg_name, FILE *o, const char *indent)
+static uint64_t signal_mask(const signal_t *sig)
 {
 	assert(sig);
-	assert(msg_name);
-	assert(o);
-	const bool motorola   = (sig->endianess == endianess_motorola_e);
-	const unsigned start  = fix_start_bit(motorola, sig->start_bit, sig->bit_length);
-	const unsigned length = sig->bit_length;
-	const uint64_t mask = length == 64 ?
+	return sig->bit_length == 64 ?
 		0xFFFFFFFFFFFFFFFFuLL :
-		(1uLL << length) - 1uLL;
+		(1uLL << sig->bit_length) - 1uLL;
+}
 
-	if (comment(sig, o, indent) < 0)
-		return -1;
+/* bits to set, within the type the signal is stored in, to sign extend a
+ * negative value, zero if there is nothing to do */
+static uint64_t signal_sign_extension(const signal_t *sig)
+{
+	assert(sig);
+	const unsigned length = sig->bit_length;
+	uint64_t negative = ~signal_mask(sig);
+	if (length <= 32)
+		negative &= 0xFFFFFFFF;
+	if (length <= 16)
+		negative &= 0xFFFF;
+	if (length <= 8)
+		negative &= 0xFF;
+	return negative;
+}
+
+/* Peephole optimizations for the shifts and masks made for each signal:
+ * - A mask is left out if the shift, or a cast to the width of the type
+ *   the signal is stored in, already clears the other bits. A byte aligned
+ *   signal of 8, 16 or 32 bits is then just a shift and a cast, which the
+ *   compiler turns into a load of that part of the payload.
+ * - Sign extension is done without a branch with '(x ^ top) - top'.
+ * - Unpack assigns the expression for each signal to its destination
+ *   without a temporary. Pack still masks into 'x' and shifts in a separate
+ *   statement, as folding the mask and the shift into one expression lets
+ *   compilers turn it into a shift by a wide mask, which is slower. */
+static unsigned type_width(unsigned length)
+{
+	return length <= 8 ? 8 : length <= 16 ? 16 : length <= 32 ? 32 : 64;
+}
 
+/* C expression for the raw value of a signal in 'source', as a uint64_t (or
+ * an unsigned type of the width of the signal) and sign extended if needed */
+static void signal_unpack_expression(char *buf, size_t length, signal_t *sig, const char *source)
+{
+	assert(buf);
+	assert(sig);
+	assert(source);
+	const bool motorola   = (sig->endianess == endianess_motorola_e);
+	const unsigned start  = fix_start_bit(motorola, sig->start_bit, sig->bit_length);
+	const unsigned bits   = sig->bit_length;
+	const unsigned width  = type_width(bits);
+	char shifted[MAX_NAME_LENGTH] = {0};
 	if (start)
-		fprintf(o, "%sx = (%c >> %d) & 0x%"PRIx64";\n", indent, motorola ? 'm' : 'i', start, mask);
+		snprintf(shifted, sizeof shifted, "(%s >> %u)", source, start);
+	else
+		snprintf(shifted, sizeof shifted, "%s", source);
+
+	char value[MAX_NAME_LENGTH * 2] = {0};
+	if (bits == 64 || start + bits == 64)
+		snprintf(value, sizeof value, "%s", shifted);
+	else if (bits == width)
+		snprintf(value, sizeof value, "(%s)%s", determine_unsigned_type(bits), shifted);
 	else
-		fprintf(o, "%sx = %c & 0x%"PRIx64";\n", indent, motorola ? 'm' : 'i',  mask);
+		snprintf(value, sizeof value, "(%s & 0x%"PRIx64")", shifted, signal_mask(sig));
+
+	if (!sig->is_floating && sig->is_signed && signal_sign_extension(sig)) {
+		const uint64_t top = (uint64_t)1 << (bits - 1);
+		snprintf(buf, length, "((%s ^ 0x%"PRIx64") - 0x%"PRIx64")", value, top, top);
+		return;
+	}
+	snprintf(buf, length, "%s", value);
+}
 
+/* C expression for the raw value of a signal to be packed, which is 'value'
+ * truncated to the width of the signal */
+static void signal_pack_expression(char *buf, size_t length, signal_t *sig, const char *value)
+{
+	assert(buf);
+	assert(sig);
+	assert(value);
+	const unsigned bits = sig->bit_length;
 	if (sig->is_floating) {
-		assert(length == 32 || length == 64);
-		if (fprintf(o, "%so->%s.%s = unpack754_%d(x);\n", indent, msg_name, sig->name, length) < 0)
-			return -1;
-		return 0;
+		assert(bits == 32 || bits == 64);
+		snprintf(buf, length, "pack754_%u(%s)", bits, value);
+	} else if (bits == type_width(bits)) {
+		snprintf(buf, length, "(%s)(%s)", determine_unsigned_type(bits), value);
+	} else {
+		snprintf(buf, length, "(%s)(%s) & 0x%"PRIx64, determine_unsigned_type(bits), value, signal_mask(sig));
 	}
+}
+
+static uint64_t byte_reverse(uint64_t x)
+{
+	uint64_t r = 0;
+	for (unsigned i = 0; i < 8; i++, x >>= 8)
+		r = (r << 8) | (x & 0xFF);
+	return r;
+}
+
+/* bits a signal occupies in the payload as given to 'unpack', before the
+ * bytes are reordered for signals of the other endianess */
+static uint64_t signal_payload_bits(const signal_t *sig)
+{
+	assert(sig);
+	const bool motorola = (sig->endianess == endianess_motorola_e);
+	const unsigned start = fix_start_bit(motorola, sig->start_bit, sig->bit_length);
+	const uint64_t bits = start < 64 ? signal_mask(sig) << start : 0;
+	return motorola == swap_motorola ? byte_reverse(bits) : bits;
+}
 
-	if (sig->is_signed) {
-		const uint64_t top = (1uL << (length - 1));
-		uint64_t negative = ~mask;
-		if (length <= 32)
-			negative &= 0xFFFFFFFF;
-		if (length <= 16)
-			negative &= 0xFFFF;
-		if (length <= 8)
-			negative &= 0xFF;
-		if (negative)
-			fprintf(o, "%sx = (x & 0x%"PRIx64") ? (x | 0x%"PRIx64") : x; \n", indent, top, negative);
+/* Lazy decoding; with '-R' each message is stored in the object holding all
+ * of them as its payload, which unpack and pack copy, and the decode, encode
+ * and print functions extract or insert the bits of their signal. This is the
+ * expression for the value of a signal as it would be in the structure for
+ * its message. */
+static void signal_field(char *buf, size_t length, const char *msgname, signal_t *sig, dbc2c_options_t *copts)
+{
+	assert(buf);
+	assert(msgname);
+	assert(sig);
+	assert(copts);
+	if (!copts->use_lazy_decoding) {
+		snprintf(buf, length, "(o->%s.%s)", msgname, sig->name);
+		return;
 	}
+	const bool motorola = (sig->endianess == endianess_motorola_e);
+	char source[MAX_NAME_LENGTH] = {0}, value[MAX_NAME_LENGTH * 2] = {0};
+	snprintf(source, sizeof source, motorola == swap_motorola ? "reverse_byte_order(o->%s)" : "o->%s", msgname);
+	signal_unpack_expression(value, sizeof value, sig, source);
+	if (sig->is_floating)
+		snprintf(buf, length, "unpack754_%u(%s)", sig->bit_length, value);
+	else
+		snprintf(buf, length, "((%s)%s)", determine_type(sig->bit_length, sig->is_signed, false), value);
+}
 
-	fprintf(o, "%so->%s.%s = x;\n", indent, msg_name, sig->name);
-	return 0;
+/* narrowest unsigned type holding the bytes of a payload that a message's
+ * signals are in, which '-R' stores the payload as */
+static const char *msg_payload_type(const can_msg_t *msg)
+{
+	assert(msg);
+	uint64_t bits = 0;
+	for (size_t i = 0; i < msg->signal_count; i++)
+		bits |= signal_payload_bits(msg->sigs[i]);
+	unsigned bytes = msg->dlc;
+	for (unsigned i = 0; i < 8; i++)
+		if ((bits >> (8 * i)) && bytes < i + 1)
+			bytes = i + 1;
+	return determine_unsigned_type(bytes * 8);
 }
 
-static int signal2serializer(signal_t *sig, const char *msg_name, FILE *o, const char *indent)
+/* assign 'value' to a signal, converting it to the type of the signal */
+static int signal_store(writer_t *o, const char *indent, const char *msgname, signal_t *sig, const char *value, dbc2c_options_t *copts)
 {
+	assert(o);
+	assert(indent);
+	assert(msgname);
 	assert(sig);
+	assert(value);
+	assert(copts);
+	if (copts->use_dirty_tracking) {
+		char field[MAX_NAME_LENGTH * 4] = {0};
+		signal_field(field, sizeof field, msgname, sig, copts);
+		writer_printf(o, "%so->%s_dirty |= %s != (%s)(%s);\n", indent, msgname, field,
+				determine_type(sig->bit_length, sig->is_signed, sig->is_floating), value);
+	}
+	if (!copts->use_lazy_decoding)
+		return writer_printf(o, "%so->%s.%s = %s;\n", indent, msgname, sig->name, value);
+	const bool motorola = (sig->endianess == endianess_motorola_e);
+	const unsigned start = fix_start_bit(motorola, sig->start_bit, sig->bit_length);
+	char typed[MAX_NAME_LENGTH] = {0}, raw[MAX_NAME_LENGTH * 2] = {0};
+	snprintf(typed, sizeof typed, "(%s)(%s)", determine_type(sig->bit_length, sig->is_signed, sig->is_floating), value);
+	signal_pack_expression(raw, sizeof raw, sig, typed);
+	return writer_printf(o, "%so->%s = (o->%s & ~UINT64_C(0x%016" PRIx64 ")) | %s((uint64_t)(%s) << %u);\n",
+			indent, msgname, msgname, signal_payload_bits(sig),
+			motorola == swap_motorola ? "reverse_byte_order" : "", raw, start);
+}
+
+/* reject the value being encoded if 'condition' holds, leaving the signal
+ * zeroed; when tracking changes the signal is only zeroed on rejection so an
+ * accepted value is compared against the value it replaces */
+static int signal_reject(writer_t *o, const char *msgname, signal_t *sig, const char *condition, dbc2c_options_t *copts)
+{
 	assert(o);
-	bool motorola = (sig->endianess == endianess_motorola_e);
-	int start = fix_start_bit(motorola, sig->start_bit, sig->bit_length);
+	assert(msgname);
+	assert(sig);
+	assert(condition);
+	assert(copts);
+	if (!copts->use_dirty_tracking)
+		return writer_printf(o, "\tif (%s)\n\t\treturn -1;\n", condition);
+	writer_printf(o, "\tif (%s) {\n", condition);
+	signal_store(o, "\t\t", msgname, sig, "0", copts);
+	return writer_puts(o, "\t\treturn -1;\n\t}\n");
+}
 
-	uint64_t mask = sig->bit_length == 64 ?
-		0xFFFFFFFFFFFFFFFFuLL :
-		(1uLL << sig->bit_length) - 1uLL;
+/* get the raw value of a signal into 'x', sign extended if needed */
+static int signal2raw(signal_t *sig, writer_t *o, const char *indent)
+{
+	assert(sig);
+	assert(o);
+	assert(indent);
+	const bool motorola = (sig->endianess == endianess_motorola_e);
+	if (comment(sig, o, indent) < 0)
+		return -1;
+	char value[MAX_NAME_LENGTH * 4] = {0};
+	signal_unpack_expression(value, sizeof value, sig, motorola ? "m" : "i");
+	return writer_printf(o, "%sx = %s;\n", indent, value);
+}
 
+static int signal2deserializer(signal_t *sig, const char *msg_name, writer_t *o, const char *indent, dbc2c_options_t *copts)
+{
+	assert(sig);
+	assert(msg_name);
+	assert(o);
+	UNUSED(copts);
+	const bool motorola = (sig->endianess == endianess_motorola_e);
 	if (comment(sig, o, indent) < 0)
 		return -1;
+	char value[MAX_NAME_LENGTH * 4] = {0};
+	signal_unpack_expression(value, sizeof value, sig, motorola ? "m" : "i");
+	if (sig->is_floating)
+		return writer_printf(o, "%so->%s.%s = unpack754_%u(%s);\n", indent, msg_name, sig->name, sig->bit_length, value);
+	return writer_printf(o, "%so->%s.%s = %s;\n", indent, msg_name, sig->name, value);
+}
 
-	if (sig->is_floating) {
-		assert(sig->bit_length == 32 || sig->bit_length == 64);
-		fprintf(o, "%sx = pack754_%u(o->%s.%s) & 0x%"PRIx64";\n", indent, sig->bit_length, msg_name, sig->name, mask);
-	} else {
-		fprintf(o, "%sx = ((%s)(o->%s.%s)) & 0x%"PRIx64";\n", indent, determine_unsigned_type(sig->bit_length), msg_name, sig->name, mask);
-	}
+static int signal2serializer(signal_t *sig, const char *msg_name, writer_t *o, const char *indent, dbc2c_options_t *copts)
+{
+	assert(sig);
+	assert(o);
+	UNUSED(copts);
+	const bool motorola = (sig->endianess == endianess_motorola_e);
+	const unsigned start = fix_start_bit(motorola, sig->start_bit, sig->bit_length);
+	if (comment(sig, o, indent) < 0)
+		return -1;
+	char field[MAX_NAME_LENGTH * 2] = {0}, value[MAX_NAME_LENGTH * 4] = {0};
+	snprintf(field, sizeof field, "o->%s.%s", msg_name, sig->name);
+	signal_pack_expression(value, sizeof value, sig, field);
+	writer_printf(o, "%sx = %s;\n", indent, value);
 	if (start)
-		fprintf(o, "%sx <<= %u; \n", indent, start);
-	fprintf(o, "%s%c |= x;\n", indent, motorola ? 'm' : 'i');
-	return 0;
+		return writer_printf(o, "%s%c |= x << %u;\n", indent, motorola ? 'm' : 'i', start);
+	return writer_printf(o, "%s%c |= x;\n", indent, motorola ? 'm' : 'i');
 }
 
-static int signal2print(signal_t *sig, unsigned id, const char *msg_name, FILE *o)
+static int signal2print(signal_t *sig, unsigned id, const char *msg_name, writer_t *o, dbc2c_options_t *copts)
 {
 	UNUSED(id);
 	/*super lazy*/
+	char field[MAX_NAME_LENGTH * 4] = {0};
+	signal_field(field, sizeof field, msg_name, sig, copts);
 	if (sig->is_floating)
-		return fprintf(o, "\tr = print_helper(r, fprintf(output, \"%s = (wire: %%g)\\n\", (double)(o->%s.%s)));\n", sig->name, msg_name, sig->name);
-	return fprintf(o, "\tr = print_helper(r, fprintf(output, \"%s = (wire: %%.0f)\\n\", (double)(o->%s.%s)));\n", sig->name, msg_name, sig->name);
+		return writer_printf(o, "\tr = print_helper(r, fprintf(output, \"%s = (wire: %%g)\\n\", (double)%s));\n", sig->name, field);
+	return writer_printf(o, "\tr = print_helper(r, fprintf(output, \"%s = (wire: %%.0f)\\n\", (double)%s));\n", sig->name, field);
 }
 
-static int signal2type(signal_t *sig, FILE *o)
+static int signal2type(signal_t *sig, writer_t *o)
 {
 	assert(sig);
 	assert(o);
@@ -266,13 +475,13 @@ static int signal2type(signal_t *sig, FILE *o)
 	}
 
 	if (sig->comment) {
-		fprintf(o, "\t/* %s: %s */\n", sig->name, sig->comment);
-		return fprintf(o, "\t/* scaling %.1f, offset %.1f, units %s %s */\n\t%s %s;\n",
+		writer_printf(o, "\t/* %s: %s */\n", sig->name, sig->comment);
+		return writer_printf(o, "\t/* scaling %.1f, offset %.1f, units %s %s */\n\t%s %s;\n",
 				sig->scaling, sig->offset, sig->units[0] ? sig->units : "none",
 				sig->is_floating ? ", floating" : "",
 				type, sig->name);
 	} else {
-		return fprintf(o, "\t%s %s; /* scaling %.1f, offset %.1f, units %s %s */\n",
+		return writer_printf(o, "\t%s %s; /* scaling %.1f, offset %.1f, units %s %s */\n",
 				type, sig->name, sig->scaling, sig->offset, sig->units[0] ? sig->units : "none",
 				sig->is_floating ? ", floating" : "");
 	}
@@ -308,7 +517,280 @@ static int64_t signed_min(signal_t *sig)
 	return ~signed_max(sig);
 }
 
-static int signal2scaling_encode(const char *msgname, unsigned id, signal_t *sig, FILE *o, bool header, const char *god, dbc2c_options_t *copts)
+/* Work out which of the minimum and maximum of a signal need checking, the
+ * ones that are not already implied by the type of the signal. */
+static void signal_range_checks(signal_t *sig, bool *gmin, bool *gmax)
+{
+	assert(sig);
+	assert(gmin);
+	assert(gmax);
+	if (sig->is_signed) { /**@warning comparison may fail because of limits of double size */
+		*gmin = sig->minimum > signed_min(sig);
+		*gmax = sig->maximum < signed_max(sig);
+	} else {
+		*gmin = sig->minimum > 0.0;
+		*gmax = sig->maximum < unsigned_max(sig);
+	}
+	if (sig->is_floating) {
+		*gmax = true;
+		*gmax = true;
+	}
+}
+
+static bool signal_is_scaled(const signal_t *sig)
+{
+	assert(sig);
+	return sig->scaling != 1.0 || sig->offset != 0.0;
+}
+
+/* The type scaled signals are decoded to, if they are not fixed point */
+static const char *scaled_type(dbc2c_options_t *copts)
+{
+	assert(copts);
+	return copts->use_floats_for_encoding && !copts->use_doubles_for_encoding ? "float" : "double";
+}
+
+/* Is arithmetic on a value of this type meant to be done in single precision */
+static bool single_precision(const char *type, dbc2c_options_t *copts)
+{
+	assert(type);
+	assert(copts);
+	return copts->use_floats_for_encoding && !strcmp(type, "float");
+}
+
+/* Format a constant for the generated code. Constants used with a 'float'
+ * are written as float constants, so the arithmetic is not done in double. */
+static const char *constant(char *buf, size_t length, double d, bool single)
+{
+	assert(buf);
+	if (!single) {
+		snprintf(buf, length, "%g", d);
+		return buf;
+	}
+	char number[MAX_CONSTANT_LENGTH] = {0};
+	snprintf(number, sizeof number, "%.9g", d);
+	snprintf(buf, length, "%s%sf", number, strpbrk(number, ".e") ? "" : ".0");
+	return buf;
+}
+
+/* With the fixed point option a scaled signal is decoded to an integer, the
+ * physical value multiplied by 'denominator', if its scaling and offset are
+ * whole multiples of one over a power of two or of ten. That integer is
+ * then 'raw * multiplier + offset', which is exact and needs no floating
+ * point. A power of two denominator makes the output a Q format number. */
+typedef struct {
+	int64_t multiplier;  /**< scaling times denominator */
+	int64_t offset;      /**< offset times denominator */
+	int64_t denominator; /**< physical value is the decoded value over this */
+	const char *type;    /**< type decoded values are stored in */
+} fixed_t;
+
+static bool is_whole(double d)
+{
+	return fabs(d) < 0x1p62 && d == floor(d);
+}
+
+static bool signal_fixed(const signal_t *sig, fixed_t *f, dbc2c_options_t *copts)
+{
+	assert(sig);
+	assert(f);
+	assert(copts);
+	if (!copts->use_fixed_point || copts->use_doubles_for_encoding)
+		return false;
+	if (!signal_is_scaled(sig) || sig->is_floating || sig->scaling == 0.0)
+		return false;
+
+	int64_t denominator = 0;
+	for (int64_t two = 1, ten = 1; two <= (1ll << 32) || ten <= 1000000000ll;) {
+		const int64_t d = two < ten ? two : ten;
+		if (is_whole(sig->scaling * d) && is_whole(sig->offset * d)) {
+			denominator = d;
+			break;
+		}
+		if (d == two)
+			two *= 2;
+		else
+			ten *= 10;
+	}
+	if (!denominator)
+		return false;
+
+	const double multiplier = sig->scaling * denominator;
+	const double offset = sig->offset * denominator;
+	const double raw_min = sig->is_signed ? (double)signed_min((signal_t*)sig) : 0.0;
+	const double raw_max = sig->is_signed ? (double)signed_max((signal_t*)sig) : (double)unsigned_max((signal_t*)sig);
+	const double a = raw_min * multiplier + offset, b = raw_max * multiplier + offset;
+	const double largest = fmax(fabs(a), fabs(b)) + fabs(offset);
+	if (largest >= 0x1p62)
+		return false;
+	f->multiplier  = multiplier;
+	f->offset      = offset;
+	f->denominator = denominator;
+	f->type        = largest < 0x1p31 ? "int32_t" : "int64_t";
+	return true;
+}
+
+static int fixed_comment(const signal_t *sig, const fixed_t *f, writer_t *o)
+{
+	assert(sig);
+	assert(f);
+	assert(o);
+	if (f->denominator == 1)
+		return writer_printf(o, "/* %s: fixed point, whole units */\n", sig->name);
+	unsigned q = 0;
+	while ((1ll << q) < f->denominator)
+		q++;
+	if ((1ll << q) == f->denominator)
+		return writer_printf(o, "/* %s: fixed point Q%u, physical value is the value / %"PRId64" */\n", sig->name, q, f->denominator);
+	return writer_printf(o, "/* %s: fixed point, physical value is the value / %"PRId64" */\n", sig->name, f->denominator);
+}
+
+/* range checks on a fixed point value, in the units of that value; returns
+ * false if there is nothing to check */
+static bool fixed_range(signal_t *sig, const fixed_t *f, int64_t *min, int64_t *max, bool *gmin, bool *gmax)
+{
+	assert(sig);
+	assert(f);
+	assert(min);
+	assert(max);
+	assert(gmin);
+	assert(gmax);
+	*gmin = false;
+	*gmax = false;
+	if (!signal_are_min_max_valid(sig))
+		return false;
+	signal_range_checks(sig, gmin, gmax);
+	const double lo = ceil(sig->minimum * f->denominator), hi = floor(sig->maximum * f->denominator);
+	*gmin = *gmin && fabs(lo) < 0x1p62;
+	*gmax = *gmax && fabs(hi) < 0x1p62;
+	*min = *gmin ? (int64_t)lo : 0;
+	*max = *gmax ? (int64_t)hi : 0;
+	return *gmin || *gmax;
+}
+
+/* C expression, in the fixed point type, for the raw value 'raw' */
+static void fixed_decode_expression(char *buf, size_t length, const fixed_t *f, const char *raw)
+{
+	assert(buf);
+	assert(f);
+	assert(raw);
+	int r = snprintf(buf, length, "(%s)%s", f->type, raw);
+	if (f->multiplier != 1 && r > 0 && (size_t)r < length)
+		r += snprintf(buf + r, length - r, " * %"PRId64, f->multiplier);
+	if (f->offset && r > 0 && (size_t)r < length)
+		snprintf(buf + r, length - r, " %c %"PRId64, f->offset < 0 ? '-' : '+', f->offset < 0 ? -f->offset : f->offset);
+}
+
+/* C expression for the raw value of the fixed point value 'value' */
+static void fixed_encode_expression(char *buf, size_t length, const fixed_t *f, const char *value)
+{
+	assert(buf);
+	assert(f);
+	assert(value);
+	const char sign = f->offset < 0 ? '+' : '-';
+	const int64_t offset = f->offset < 0 ? -f->offset : f->offset;
+	if (f->offset && f->multiplier != 1)
+		snprintf(buf, length, "(((int64_t)%s %c %"PRId64") / %"PRId64")", value, sign, offset, f->multiplier);
+	else if (f->offset)
+		snprintf(buf, length, "((int64_t)%s %c %"PRId64")", value, sign, offset);
+	else
+		snprintf(buf, length, "((int64_t)%s / %"PRId64")", value, f->multiplier);
+}
+
+/* With '-i' the encode and decode functions are defined in the header, and
+ * so are 'static inline', instead of having a prototype there */
+static int function_linkage(writer_t *o, bool header, dbc2c_options_t *copts)
+{
+	assert(o);
+	assert(copts);
+	if (header || !copts->generate_inline)
+		return 0;
+	return writer_puts(o, "static inline ");
+}
+
+static int signal2fixed_encode(const char *msgname, unsigned id, signal_t *sig, const fixed_t *f, writer_t *o, bool header, const char *god, dbc2c_options_t *copts)
+{
+	assert(msgname);
+	assert(sig);
+	assert(f);
+	assert(o);
+	assert(copts);
+	function_linkage(o, header, copts);
+	if (copts->use_id_in_name)
+		writer_printf(o, "int candb_encode_%s_%s_0x%03x(can_%s_t *o, %s in)", god, sig->name, id, god, f->type);
+	else
+		writer_printf(o, "int candb_encode_%s_%s(can_%s_t *o, %s in)", god, sig->name, god, f->type);
+	if (header)
+		return writer_puts(o, ";\n");
+	writer_puts(o, " {\n");
+	if (copts->generate_asserts)
+		writer_puts(o, "\tassert(o);\n");
+	int64_t min = 0, max = 0;
+	bool gmin = false, gmax = false;
+	char condition[MAX_CONSTANT_LENGTH + 8] = {0};
+	if (fixed_range(sig, f, &min, &max, &gmin, &gmax) && !copts->use_dirty_tracking)
+		signal_store(o, "\t", msgname, sig, "0", copts);
+	if (gmin) {
+		snprintf(condition, sizeof condition, "in < %"PRId64, min);
+		signal_reject(o, msgname, sig, condition, copts);
+	}
+	if (gmax) {
+		snprintf(condition, sizeof condition, "in > %"PRId64, max);
+		signal_reject(o, msgname, sig, condition, copts);
+	}
+	char value[MAX_NAME_LENGTH] = {0};
+	fixed_encode_expression(value, sizeof value, f, "in");
+	signal_store(o, "\t", msgname, sig, value, copts);
+	return writer_puts(o, "\treturn 0;\n}\n\n");
+}
+
+static int signal2fixed_decode(const char *msgname, unsigned id, signal_t *sig, const fixed_t *f, writer_t *o, bool header, const char *god, dbc2c_options_t *copts)
+{
+	assert(msgname);
+	assert(sig);
+	assert(f);
+	assert(o);
+	assert(copts);
+	if (header && fixed_comment(sig, f, o) < 0)
+		return -1;
+	function_linkage(o, header, copts);
+	if (copts->use_id_in_name)
+		writer_printf(o, "int candb_decode_%s_%s_0x%03x(const can_%s_t *o, %s *out)", god, sig->name, id, god, f->type);
+	else
+		writer_printf(o, "int candb_decode_%s_%s(const can_%s_t *o, %s *out)", god, sig->name, god, f->type);
+	if (header)
+		return writer_puts(o, ";\n");
+	writer_puts(o, " {\n");
+	if (copts->generate_asserts) {
+		writer_puts(o, "\tassert(o);\n");
+		writer_puts(o, "\tassert(out);\n");
+	}
+	char raw[MAX_NAME_LENGTH * 4] = {0}, value[MAX_NAME_LENGTH * 5] = {0};
+	signal_field(raw, sizeof raw, msgname, sig, copts);
+	fixed_decode_expression(value, sizeof value, f, raw);
+	writer_printf(o, "\tconst %s rval = %s;\n", f->type, value);
+	int64_t min = 0, max = 0;
+	bool gmin = false, gmax = false;
+	if (!fixed_range(sig, f, &min, &max, &gmin, &gmax)) {
+		writer_puts(o, "\t*out = rval;\n");
+		writer_puts(o, "\treturn 0;\n");
+		return writer_puts(o, "}\n\n");
+	}
+	if (gmin && gmax)
+		writer_printf(o, "\tif ((rval >= %"PRId64") && (rval <= %"PRId64")) {\n", min, max);
+	else if (gmax)
+		writer_printf(o, "\tif (rval <= %"PRId64") {\n", max);
+	else
+		writer_printf(o, "\tif (rval >= %"PRId64") {\n", min);
+	writer_puts(o, "\t\t*out = rval;\n");
+	writer_puts(o, "\t\treturn 0;\n");
+	writer_puts(o, "\t}\n");
+	writer_puts(o, "\t*out = 0;\n");
+	writer_puts(o, "\treturn -1;\n");
+	return writer_puts(o, "}\n\n");
+}
+
+static int signal2scaling_encode(const char *msgname, unsigned id, signal_t *sig, writer_t *o, bool header, const char *god, dbc2c_options_t *copts)
 {
 	assert(msgname);
 	assert(sig);
@@ -316,53 +798,48 @@ static int signal2scaling_encode(const char *msgname, unsigned id, signal_t *sig
 	assert(copts);
 	const char *type = determine_type(sig->bit_length, sig->is_signed, sig->is_floating);
 	if (sig->scaling != 1.0 || sig->offset != 0.0)
-		type = "double";
+		type = scaled_type(copts);
+	const bool single = single_precision(type, copts);
+	char a[MAX_CONSTANT_LENGTH];
+	function_linkage(o, header, copts);
 	if (copts->use_id_in_name)
-		fprintf(o, "int candb_encode_%s_%s_0x%03x(can_%s_t *o, %s in)", god, sig->name, id, god, copts->use_doubles_for_encoding ? "double" : type);
+		writer_printf(o, "int candb_encode_%s_%s_0x%03x(can_%s_t *o, %s in)", god, sig->name, id, god, copts->use_doubles_for_encoding ? "double" : type);
 	else
-		fprintf(o, "int candb_encode_%s_%s(can_%s_t *o, %s in)", god, sig->name, god, copts->use_doubles_for_encoding ? "double" : type);
+		writer_printf(o, "int candb_encode_%s_%s(can_%s_t *o, %s in)", god, sig->name, god, copts->use_doubles_for_encoding ? "double" : type);
 
 	if (header)
-		return fputs(";\n", o);
-	fputs(" {\n", o);
+		return writer_puts(o, ";\n");
+	writer_puts(o, " {\n");
 	if (copts->generate_asserts) {
-		fputs("\tassert(o);\n", o);
+		writer_puts(o, "\tassert(o);\n");
 	}
 	if (signal_are_min_max_valid(sig)) {
-		bool gmax = true;
-		bool gmin = true;
-
-		if (sig->is_signed) {
-			gmin = sig->minimum > signed_min(sig);
-			gmax = sig->maximum < signed_max(sig);
-		} else {
-			gmin = sig->minimum > 0.0;
-			gmax = sig->maximum < unsigned_max(sig);
+		bool gmin = true, gmax = true;
+		signal_range_checks(sig, &gmin, &gmax);
+		char condition[MAX_CONSTANT_LENGTH + 8] = {0};
+		if ((gmin || gmax) && !copts->use_dirty_tracking)
+			signal_store(o, "\t", msgname, sig, "0", copts); // cast!
+		if (gmin) {
+			snprintf(condition, sizeof condition, "in < %s", constant(a, sizeof a, sig->minimum, single));
+			signal_reject(o, msgname, sig, condition, copts);
 		}
-		if (sig->is_floating) {
-			gmax = true;
-			gmax = true;
+		if (gmax) {
+			snprintf(condition, sizeof condition, "in > %s", constant(a, sizeof a, sig->maximum, single));
+			signal_reject(o, msgname, sig, condition, copts);
 		}
-
-		if (gmin || gmax)
-			fprintf(o, "\to->%s.%s = 0;\n", msgname, sig->name); // cast!
-		if (gmin)
-			fprintf(o, "\tif (in < %g)\n\t\treturn -1;\n", sig->minimum);
-		if (gmax)
-			fprintf(o, "\tif (in > %g)\n\t\treturn -1;\n", sig->maximum);
 	}
 
 	if (sig->scaling == 0.0)
 		error("invalid scaling factor (fix your DBC file)");
 	if (sig->offset != 0.0)
-		fprintf(o, "\tin += %g;\n", -1.0 * sig->offset);
+		writer_printf(o, "\tin += %s;\n", constant(a, sizeof a, -1.0 * sig->offset, single));
 	if (sig->scaling != 1.0)
-		fprintf(o, "\tin *= %g;\n", 1.0 / sig->scaling);
-	fprintf(o, "\to->%s.%s = in;\n", msgname, sig->name); // cast!
-	return fputs("\treturn 0;\n}\n\n", o);
+		writer_printf(o, "\tin *= %s;\n", constant(a, sizeof a, 1.0 / sig->scaling, single));
+	signal_store(o, "\t", msgname, sig, "in", copts); // cast!
+	return writer_puts(o, "\treturn 0;\n}\n\n");
 }
 
-static int signal2scaling_decode(const char *msgname, unsigned id, signal_t *sig, FILE *o, bool header, const char *god, dbc2c_options_t *copts)
+static int signal2scaling_decode(const char *msgname, unsigned id, signal_t *sig, writer_t *o, bool header, const char *god, dbc2c_options_t *copts)
 {
 	assert(msgname);
 	assert(sig);
@@ -370,309 +847,826 @@ static int signal2scaling_decode(const char *msgname, unsigned id, signal_t *sig
 	assert(copts);
 	const char *type = determine_type(sig->bit_length, sig->is_signed, sig->is_floating);
 	if (sig->scaling != 1.0 || sig->offset != 0.0)
-		type = "double";
+		type = scaled_type(copts);
+	const bool single = single_precision(type, copts);
+	char a[MAX_CONSTANT_LENGTH], b[MAX_CONSTANT_LENGTH];
+	function_linkage(o, header, copts);
 	if (copts->use_id_in_name)
-		fprintf(o, "int candb_decode_%s_%s_0x%03x(const can_%s_t *o, %s *out)", god, sig->name, id, god, copts->use_doubles_for_encoding ? "double" : type);
+		writer_printf(o, "int candb_decode_%s_%s_0x%03x(const can_%s_t *o, %s *out)", god, sig->name, id, god, copts->use_doubles_for_encoding ? "double" : type);
 	else
-		fprintf(o, "int candb_decode_%s_%s(const can_%s_t *o, %s *out)", god, sig->name, god, copts->use_doubles_for_encoding ? "double" : type);
+		writer_printf(o, "int candb_decode_%s_%s(const can_%s_t *o, %s *out)", god, sig->name, god, copts->use_doubles_for_encoding ? "double" : type);
 	if (header)
-		return fputs(";\n", o);
-	fputs(" {\n", o);
+		return writer_puts(o, ";\n");
+	writer_puts(o, " {\n");
 	if (copts->generate_asserts) {
-		fputs("\tassert(o);\n", o);
-		fputs("\tassert(out);\n", o);
+		writer_puts(o, "\tassert(o);\n");
+		writer_puts(o, "\tassert(out);\n");
 	}
-	fprintf(o, "\t%s rval = (%s)(o->%s.%s);\n", type, type, msgname, sig->name);
+	char field[MAX_NAME_LENGTH * 4] = {0};
+	signal_field(field, sizeof field, msgname, sig, copts);
+	writer_printf(o, "\t%s rval = (%s)%s;\n", type, type, field);
 	if (sig->scaling == 0.0)
 		error("invalid scaling factor (fix your DBC file)");
 	if (sig->scaling != 1.0)
-		fprintf(o, "\trval *= %g;\n", sig->scaling);
+		writer_printf(o, "\trval *= %s;\n", constant(a, sizeof a, sig->scaling, single));
 	if (sig->offset != 0.0)
-		fprintf(o, "\trval += %g;\n", sig->offset);
+		writer_printf(o, "\trval += %s;\n", constant(a, sizeof a, sig->offset, single));
 	if (signal_are_min_max_valid(sig)) {
-		bool gmax = true;
-		bool gmin = true;
-
-		if (sig->is_signed) { /**@warning comparison may fail because of limits of double size */
-			gmin = sig->minimum > signed_min(sig);
-			gmax = sig->maximum < signed_max(sig);
-		} else {
-			gmin = sig->minimum > 0.0;
-			gmax = sig->maximum < unsigned_max(sig);
-		}
-		if (sig->is_floating) {
-			gmax = true;
-			gmax = true;
-		}
-
+		bool gmin = true, gmax = true;
+		signal_range_checks(sig, &gmin, &gmax);
 		if (!gmax && !gmin) {
-			fputs("\t*out = rval;\n", o);
-			fputs("\treturn 0;\n", o);
+			writer_puts(o, "\t*out = rval;\n");
+			writer_puts(o, "\treturn 0;\n");
 		} else {
 			if (gmin && gmax) {
-				fprintf(o, "\tif ((rval >= %g) && (rval <= %g)) {\n", sig->minimum, sig->maximum);
+				writer_printf(o, "\tif ((rval >= %s) && (rval <= %s)) {\n", constant(a, sizeof a, sig->minimum, single), constant(b, sizeof b, sig->maximum, single));
 			} else if (gmax) {
-				fprintf(o, "\tif (rval <= %g) {\n", sig->maximum);
+				writer_printf(o, "\tif (rval <= %s) {\n", constant(a, sizeof a, sig->maximum, single));
 			} else if (gmin) {
-				fprintf(o, "\tif (rval >= %g) {\n", sig->minimum);
+				writer_printf(o, "\tif (rval >= %s) {\n", constant(a, sizeof a, sig->minimum, single));
 			}
-			fputs("\t\t*out = rval;\n", o);
-			fputs("\t\treturn 0;\n", o);
-			fputs("\t} else {\n", o);
-			fprintf(o, "\t\t*out = (%s)0;\n", type);
-			fputs("\t\treturn -1;\n", o);
-			fputs("\t}\n", o);
+			writer_puts(o, "\t\t*out = rval;\n");
+			writer_puts(o, "\t\treturn 0;\n");
+			writer_puts(o, "\t} else {\n");
+			writer_printf(o, "\t\t*out = (%s)0;\n", type);
+			writer_puts(o, "\t\treturn -1;\n");
+			writer_puts(o, "\t}\n");
 
 		}
 
 
 	} else {
-		fputs("\t*out = rval;\n", o);
-		fputs("\treturn 0;\n", o);
+		writer_puts(o, "\t*out = rval;\n");
+		writer_puts(o, "\treturn 0;\n");
 	}
-	return fputs("}\n\n", o);
+	return writer_puts(o, "}\n\n");
 }
 
-static int signal2scaling(const char *msgname, unsigned id, signal_t *sig, FILE *o, bool decode, bool header, const char *god, dbc2c_options_t *copts)
+/* Column extraction; pull one signal out of an array of payloads for the
+ * same message, for processing logs a message at a time. Each function is a
+ * single loop of shifts and masks, using the same expression as unpack (so
+ * sign extension has no branch), which a vectorizing compiler (GCC with
+ * '-O3', not '-O2') can turn into SIMD instructions. 'decode' functions also
+ * apply the scaling and offset (but not range checks), they are only made for
+ * signals that have a scaling or offset. */
+static int signal2extract(unsigned id, signal_t *sig, writer_t *o, bool decode, bool header, const char *god, dbc2c_options_t *copts)
 {
-	assert(copts);
-	if (decode)
-		return signal2scaling_decode(msgname, id, sig, o, header, god, copts);
-	return signal2scaling_encode(msgname, id, sig, o, header, god, copts);
-}
-
-static int print_function_name(FILE *out, const char *prefix, const char *name, const char *postfix, bool in, char *datatype, bool dlc, const char *god)
-{
-	assert(out);
-	assert(prefix);
-	assert(name);
+	assert(sig);
+	assert(o);
 	assert(god);
-	assert(postfix);
-	return fprintf(out, "static int %s_%s_%s(can_%s_t *o, %s %sdata%s)%s",
-			prefix, god, name, god, datatype,
-			in ? "" : "*",
-			dlc ? ", uint8_t dlc, dbcc_time_stamp_t time_stamp" : "",
-			postfix);
-}
-
-static void make_name(char *newname, size_t maxlen, const char *name, unsigned id, dbc2c_options_t *copts)
-{
-	assert(newname);
-	assert(name);
 	assert(copts);
+	const char *type = determine_type(sig->bit_length, sig->is_signed, sig->is_floating);
+	const char *restrict_ = header ? "" : "restrict ";
+	fixed_t f;
+	const bool fixed = decode && signal_fixed(sig, &f, copts);
+	writer_printf(o, "void candb_extract_%s%s_%s", decode ? "decode_" : "", god, sig->name);
 	if (copts->use_id_in_name)
-		snprintf(newname, maxlen-1, "can_%s_0x%03x", name, id);
-	else
-		snprintf(newname, maxlen-1, "can_%s", name);
-}
+		writer_printf(o, "_0x%03x", id);
+	writer_printf(o, "(const uint64_t *%sdata, size_t n, %s *%sout)", restrict_, fixed ? f.type : decode ? scaled_type(copts) : type, restrict_);
+	if (header)
+		return writer_puts(o, ";\n");
+	writer_puts(o, " {\n");
+	if (copts->generate_asserts) {
+		writer_puts(o, "\tassert(data || !n);\n");
+		writer_puts(o, "\tassert(out || !n);\n");
+	}
 
-static signal_t *find_multiplexor(can_msg_t *msg) {
-	assert(msg);
-	signal_t *multiplexor = NULL;
-	for (size_t i = 0; i < msg->signal_count; i++) {
-		signal_t *sig = msg->sigs[i];
-		if (sig->is_multiplexor) {
-			if (multiplexor)
-				error("multiple multiplexor values detected (only one per CAN msg is allowed) for %s", msg->name);
-			multiplexor = sig;
-		}
-		if (sig->is_multiplexed)
-			continue;
+	const bool motorola = (sig->endianess == endianess_motorola_e);
+	const char *payload = motorola == swap_motorola ? "reverse_byte_order(data[i])" : "data[i]";
+	char raw[MAX_NAME_LENGTH * 4] = {0};
+	signal_unpack_expression(raw, sizeof raw, sig, payload);
+	writer_puts(o, "\tfor (size_t i = 0; i < n; i++) {\n");
+	if (sig->is_floating) {
+		assert(sig->bit_length == 32 || sig->bit_length == 64);
+		writer_printf(o, "\t\tconst %s v = unpack754_%u(%s);\n", type, sig->bit_length, raw);
+	} else {
+		writer_printf(o, "\t\tconst %s v = %s;\n", type, raw);
 	}
-	return multiplexor;
+	if (fixed) {
+		char value[MAX_NAME_LENGTH] = {0};
+		fixed_decode_expression(value, sizeof value, &f, "v");
+		writer_printf(o, "\t\tout[i] = %s;\n", value);
+	} else if (decode) {
+		if (sig->scaling == 0.0)
+			error("invalid scaling factor (fix your DBC file)");
+		const bool single = single_precision(scaled_type(copts), copts);
+		char a[MAX_CONSTANT_LENGTH];
+		writer_puts(o, "\t\tout[i] = v");
+		if (sig->scaling != 1.0)
+			writer_printf(o, " * %s", constant(a, sizeof a, sig->scaling, single));
+		if (sig->offset != 0.0)
+			writer_printf(o, " + %s", constant(a, sizeof a, sig->offset, single));
+		writer_puts(o, ";\n");
+	} else {
+		writer_puts(o, "\t\tout[i] = v;\n");
+	}
+	writer_puts(o, "\t}\n");
+	return writer_puts(o, "}\n\n");
 }
 
-static signal_t *process_signals_and_find_multiplexer(can_msg_t *msg, FILE *c, const char *name, bool serialize)
+static int msg2extract(can_msg_t *msg, writer_t *o, bool header, const char *god, dbc2c_options_t *copts)
 {
 	assert(msg);
-	assert(c);
-	assert(name);
-	signal_t *multiplexor = NULL;
-
+	assert(o);
+	assert(copts);
 	for (size_t i = 0; i < msg->signal_count; i++) {
 		signal_t *sig = msg->sigs[i];
-		if (sig->is_multiplexor) {
-			if (multiplexor)
-				error("multiple multiplexor values detected (only one per CAN msg is allowed) for %s", name);
-			multiplexor = sig;
-		}
-		if (sig->is_multiplexed)
-			continue;
-		if ((serialize ? signal2serializer(sig, name, c, "\t") : signal2deserializer(sig, name, c, "\t")) < 0)
-			error("%s failed", serialize ? "serialization" : "deserialization");
+		if (signal2extract(msg->id, sig, o, false, header, god, copts) < 0)
+			return -1;
+		if (signal_is_scaled(sig) && signal2extract(msg->id, sig, o, true, header, god, copts) < 0)
+			return -1;
 	}
-	return multiplexor;
+	return 0;
 }
 
-static int cmp_signal(const void *lhs, const void *rhs)
+/* The type a signal has once decoded, as used by 'candb_decode' */
+static const char *signal_physical_type(signal_t *sig, dbc2c_options_t *copts)
 {
-	assert(lhs);
-	assert(rhs);
-	int ret = 0;
-	if ((*(signal_t**)lhs)->switchval < ((*(signal_t**)rhs)->switchval))
-		ret = -1;
+	assert(sig);
+	assert(copts);
+	fixed_t f;
+	if (signal_fixed(sig, &f, copts))
+		return f.type;
+	if (copts->use_doubles_for_encoding)
+		return "double";
+	if (signal_is_scaled(sig))
+		return scaled_type(copts);
+	return determine_type(sig->bit_length, sig->is_signed, sig->is_floating);
+}
+
+/* Warn about signals whose decoded values a float cannot hold, because they
+ * are out of its range or because neighbouring values round to the same
+ * float */
+static void signal_float_check(const char *msgname, signal_t *sig, dbc2c_options_t *copts)
+{
+	assert(msgname);
+	assert(sig);
+	assert(copts);
+	if (strcmp(signal_physical_type(sig, copts), "float"))
+		return;
+	if (sig->is_floating) {
+		if (sig->bit_length == 64)
+			warning("signal %s in %s is a double but is decoded as a float", sig->name, msgname);
+		return;
+	}
+	double lo = sig->minimum, hi = sig->maximum;
+	if (!signal_are_min_max_valid(sig)) {
+		lo = (sig->is_signed ? (double)signed_min(sig) : 0.0) * sig->scaling + sig->offset;
+		hi = (sig->is_signed ? (double)signed_max(sig) : (double)unsigned_max(sig)) * sig->scaling + sig->offset;
+	}
+	const double largest = fmax(fabs(lo), fabs(hi));
+	if (largest > FLT_MAX)
+		warning("signal %s in %s: range %g to %g does not fit in a float", sig->name, msgname, lo, hi);
+	else if (largest > 0.0 && ldexp(1.0, ilogb(largest) - (FLT_MANT_DIG - 1)) > fabs(sig->scaling))
+		warning("signal %s in %s: a float cannot hold every step of %g between %g and %g", sig->name, msgname, sig->scaling, lo, hi);
+}
+
+/* Physical value codecs, these move a signal straight between the payload and
+ * a structure of decoded values, doing the same scaling and range checks as
+ * the 'candb_decode' and 'candb_encode' functions. The raw value of the
+ * multiplexor is kept in 'mux' for the switch on the multiplexed signals. */
+static int signal2physical_decode(signal_t *sig, const char *msg_name, writer_t *o, const char *indent, dbc2c_options_t *copts)
+{
+	assert(sig);
+	assert(o);
+	assert(copts);
+	UNUSED(msg_name);
+	if (signal2raw(sig, o, indent) < 0)
+		return -1;
+	if (sig->is_multiplexor)
+		writer_printf(o, "%smux = x;\n", indent);
+	if (sig->scaling == 0.0)
+		error("invalid scaling factor (fix your DBC file)");
+
+	fixed_t f;
+	if (signal_fixed(sig, &f, copts)) {
+		char raw[MAX_NAME_LENGTH] = {0}, value[MAX_NAME_LENGTH * 2] = {0};
+		snprintf(raw, sizeof raw, "(%s)x", determine_type(sig->bit_length, sig->is_signed, false));
+		fixed_decode_expression(value, sizeof value, &f, raw);
+		writer_printf(o, "%sp->%s = %s;\n", indent, sig->name, value);
+		int64_t min = 0, max = 0;
+		bool gmin = false, gmax = false;
+		if (!fixed_range(sig, &f, &min, &max, &gmin, &gmax))
+			return 0;
+		if (gmin && gmax)
+			writer_printf(o, "%sif (!((p->%s >= %"PRId64") && (p->%s <= %"PRId64"))) {\n", indent, sig->name, min, sig->name, max);
+		else if (gmax)
+			writer_printf(o, "%sif (!(p->%s <= %"PRId64")) {\n", indent, sig->name, max);
+		else
+			writer_printf(o, "%sif (!(p->%s >= %"PRId64")) {\n", indent, sig->name, min);
+		writer_printf(o, "%s\tp->%s = 0;\n", indent, sig->name);
+		writer_printf(o, "%s\tr = -1;\n", indent);
+		return writer_printf(o, "%s}\n", indent);
+	}
+
+	const bool single = single_precision(signal_physical_type(sig, copts), copts);
+	char a[MAX_CONSTANT_LENGTH], b[MAX_CONSTANT_LENGTH];
+	writer_printf(o, "%sp->%s = ", indent, sig->name);
+	if (signal_is_scaled(sig))
+		writer_printf(o, "(%s)", scaled_type(copts));
+	if (sig->is_floating)
+		writer_printf(o, "unpack754_%u(x)", sig->bit_length);
+	else
+		writer_printf(o, "(%s)x", determine_type(sig->bit_length, sig->is_signed, false));
+	if (sig->scaling != 1.0)
+		writer_printf(o, " * %s", constant(a, sizeof a, sig->scaling, single));
+	if (sig->offset != 0.0)
+		writer_printf(o, " + %s", constant(a, sizeof a, sig->offset, single));
+	writer_puts(o, ";\n");
+
+	if (!signal_are_min_max_valid(sig))
+		return 0;
+	bool gmin = true, gmax = true;
+	signal_range_checks(sig, &gmin, &gmax);
+	if (gmin && gmax)
+		writer_printf(o, "%sif (!((p->%s >= %s) && (p->%s <= %s))) {\n", indent,
+				sig->name, constant(a, sizeof a, sig->minimum, single),
+				sig->name, constant(b, sizeof b, sig->maximum, single));
+	else if (gmax)
+		writer_printf(o, "%sif (!(p->%s <= %s)) {\n", indent, sig->name, constant(a, sizeof a, sig->maximum, single));
+	else if (gmin)
+		writer_printf(o, "%sif (!(p->%s >= %s)) {\n", indent, sig->name, constant(a, sizeof a, sig->minimum, single));
+	else
+		return 0;
+	writer_printf(o, "%s\tp->%s = 0;\n", indent, sig->name);
+	writer_printf(o, "%s\tr = -1;\n", indent);
+	return writer_printf(o, "%s}\n", indent);
+}
+
+static int signal2physical_encode(signal_t *sig, const char *msg_name, writer_t *o, const char *indent, dbc2c_options_t *copts)
+{
+	assert(sig);
+	assert(o);
+	assert(copts);
+	UNUSED(msg_name);
+	const bool motorola = (sig->endianess == endianess_motorola_e);
+	const unsigned start = fix_start_bit(motorola, sig->start_bit, sig->bit_length);
+
+	if (comment(sig, o, indent) < 0)
+		return -1;
+	if (sig->scaling == 0.0)
+		error("invalid scaling factor (fix your DBC file)");
+
+	char value[MAX_NAME_LENGTH * 2] = {0};
+	fixed_t f;
+	if (signal_fixed(sig, &f, copts)) {
+		int64_t min = 0, max = 0;
+		bool gmin = false, gmax = false;
+		fixed_range(sig, &f, &min, &max, &gmin, &gmax);
+		if (gmin)
+			writer_printf(o, "%sif (p->%s < %"PRId64")\n%s\treturn -1;\n", indent, sig->name, min, indent);
+		if (gmax)
+			writer_printf(o, "%sif (p->%s > %"PRId64")\n%s\treturn -1;\n", indent, sig->name, max, indent);
+		char field[MAX_NAME_LENGTH] = {0};
+		snprintf(field, sizeof field, "p->%s", sig->name);
+		fixed_encode_expression(value, sizeof value, &f, field);
+	} else {
+		const bool single = single_precision(signal_physical_type(sig, copts), copts);
+		char a[MAX_CONSTANT_LENGTH], b[MAX_CONSTANT_LENGTH];
+		if (signal_are_min_max_valid(sig)) {
+			bool gmin = true, gmax = true;
+			signal_range_checks(sig, &gmin, &gmax);
+			if (gmin)
+				writer_printf(o, "%sif (p->%s < %s)\n%s\treturn -1;\n", indent, sig->name, constant(a, sizeof a, sig->minimum, single), indent);
+			if (gmax)
+				writer_printf(o, "%sif (p->%s > %s)\n%s\treturn -1;\n", indent, sig->name, constant(a, sizeof a, sig->maximum, single), indent);
+		}
+		constant(a, sizeof a, -1.0 * sig->offset, single);
+		constant(b, sizeof b, 1.0 / sig->scaling, single);
+		if (sig->offset != 0.0 && sig->scaling != 1.0)
+			snprintf(value, sizeof value, "((p->%s + %s) * %s)", sig->name, a, b);
+		else if (sig->offset != 0.0)
+			snprintf(value, sizeof value, "(p->%s + %s)", sig->name, a);
+		else if (sig->scaling != 1.0)
+			snprintf(value, sizeof value, "(p->%s * %s)", sig->name, b);
+		else
+			snprintf(value, sizeof value, "p->%s", sig->name);
+	}
+
+	if (sig->is_floating)
+		writer_printf(o, "%sx = pack754_%u(%s) & 0x%"PRIx64";\n", indent, sig->bit_length, value, signal_mask(sig));
+	else
+		writer_printf(o, "%sx = ((%s)(%s)%s) & 0x%"PRIx64";\n", indent,
+				determine_unsigned_type(sig->bit_length),
+				determine_type(sig->bit_length, sig->is_signed, false),
+				value, signal_mask(sig));
+	if (sig->is_multiplexor)
+		writer_printf(o, "%smux = x;\n", indent);
+	if (start)
+		writer_printf(o, "%sx <<= %u; \n", indent, start);
+	return writer_printf(o, "%s%c |= x;\n", indent, motorola ? 'm' : 'i');
+}
+
+static int signal2scaling(const char *msgname, unsigned id, signal_t *sig, writer_t *o, bool decode, bool header, const char *god, dbc2c_options_t *copts)
+{
+	assert(copts);
+	fixed_t f;
+	if (signal_fixed(sig, &f, copts))
+		return decode ?
+			signal2fixed_decode(msgname, id, sig, &f, o, header, god, copts) :
+			signal2fixed_encode(msgname, id, sig, &f, o, header, god, copts);
+	if (decode)
+		return signal2scaling_decode(msgname, id, sig, o, header, god, copts);
+	return signal2scaling_encode(msgname, id, sig, o, header, god, copts);
+}
+
+static int print_function_name(writer_t *out, const char *prefix, const char *name, const char *postfix, bool in, char *datatype, bool dlc, const char *god, bool hot)
+{
+	assert(out);
+	assert(prefix);
+	assert(name);
+	assert(god);
+	assert(postfix);
+	return writer_printf(out, "static %sint %s_%s_%s(can_%s_t *o, %s %sdata%s)%s",
+			hot ? "inline " : "",
+			prefix, god, name, god, datatype,
+			in ? "" : "*",
+			dlc ? ", uint8_t dlc, dbcc_time_stamp_t time_stamp" : "",
+			postfix);
+}
+
+static void make_name(char *newname, size_t maxlen, const char *name, unsigned id, dbc2c_options_t *copts)
+{
+	assert(newname);
+	assert(name);
+	assert(copts);
+	if (copts->use_id_in_name)
+		snprintf(newname, maxlen-1, "can_%s_0x%03x", name, id);
+	else
+		snprintf(newname, maxlen-1, "can_%s", name);
+}
+
+static signal_t *find_multiplexor(can_msg_t *msg) {
+	assert(msg);
+	signal_t *multiplexor = NULL;
+	for (size_t i = 0; i < msg->signal_count; i++) {
+		signal_t *sig = msg->sigs[i];
+		if (sig->is_multiplexor) {
+			if (multiplexor)
+				error("multiple multiplexor values detected (only one per CAN msg is allowed) for %s", msg->name);
+			multiplexor = sig;
+		}
+		if (sig->is_multiplexed)
+			continue;
+	}
+	return multiplexor;
+}
+
+/* Emits the code to move one signal between a payload and a structure */
+typedef int (*signal_codec_f)(signal_t *sig, const char *msg_name, writer_t *o, const char *indent, dbc2c_options_t *copts);
+
+static signal_t *process_signals_and_find_multiplexer(can_msg_t *msg, writer_t *c, const char *name, signal_codec_f codec, dbc2c_options_t *copts)
+{
+	assert(msg);
+	assert(c);
+	assert(name);
+	signal_t *multiplexor = NULL;
+
+	for (size_t i = 0; i < msg->signal_count; i++) {
+		signal_t *sig = msg->sigs[i];
+		if (sig->is_multiplexor) {
+			if (multiplexor)
+				error("multiple multiplexor values detected (only one per CAN msg is allowed) for %s", name);
+			multiplexor = sig;
+		}
+		if (sig->is_multiplexed)
+			continue;
+		if (codec(sig, name, c, "\t", copts) < 0)
+			error("code generation failed for signal %s in %s", sig->name, name);
+	}
+	return multiplexor;
+}
+
+static int cmp_signal(const void *lhs, const void *rhs)
+{
+	assert(lhs);
+	assert(rhs);
+	int ret = 0;
+	if ((*(signal_t**)lhs)->switchval < ((*(signal_t**)rhs)->switchval))
+		ret = -1;
 	else if ((*(signal_t**)lhs)->switchval > (*(signal_t**)rhs)->switchval)
 		ret = 1;
 	return ret;
 }
-static int multiplexor_switch(can_msg_t *msg, signal_t *multiplexor, FILE *c, const char *msg_name, bool serialize)
+static int multiplexor_switch(can_msg_t *msg, const char *selector, writer_t *c, const char *msg_name, signal_codec_f codec, dbc2c_options_t *copts)
 {
 	assert(msg);
-	assert(multiplexor);
+	assert(selector);
 	assert(c);
-	fprintf(c, "\tswitch (o->%s.%s) {\n", msg_name, multiplexor->name);
-	qsort(msg->sigs, msg->signal_count, sizeof(*msg->sigs), cmp_signal);
-	for (size_t i = 0; i < msg->signal_count; i++) {
-		signal_t *sig = msg->sigs[i];
+	/* sort a copy; the order of 'msg->sigs' is the order of the structure
+	 * members and of the change bits, and must not depend on this */
+	signal_t **sigs = allocate(sizeof(*sigs) * (msg->signal_count + 1));
+	memcpy(sigs, msg->sigs, sizeof(*sigs) * msg->signal_count);
+	qsort(sigs, msg->signal_count, sizeof(*sigs), cmp_signal);
+	writer_printf(c, "\tswitch (%s) {\n", selector);
+	int r = 0;
+	for (size_t i = 0; r == 0 && i < msg->signal_count; i++) {
+		signal_t *sig = sigs[i];
 		if (!(sig->is_multiplexed))
 			continue;
-		fprintf(c, "\tcase %u:\n", sig->switchval);
+		writer_printf(c, "\tcase %u:\n", sig->switchval);
 		size_t j = i;
-		for (; j < msg->signal_count && msg->sigs[i]->switchval == msg->sigs[j]->switchval; j++) {
+		for (; j < msg->signal_count && sigs[i]->switchval == sigs[j]->switchval; j++) {
 			assert(j < msg->signal_count);
-			signal_t* sig = msg->sigs[j];
-			if ((serialize ? signal2serializer(sig, msg_name, c, "\t\t") : signal2deserializer(sig, msg_name, c, "\t\t")) < 0)
-				return -1;
+			signal_t* sig = sigs[j];
+			if (codec(sig, msg_name, c, "\t\t", copts) < 0) {
+				r = -1;
+				break;
+			}
 		}
 		i = j - 1;
 		assert(i < msg->signal_count);
-		fprintf(c, "\t\tbreak;\n");
+		writer_puts(c, "\t\tbreak;\n");
 	}
-	fprintf(c, "\tdefault:\n\t\treturn -1;\n\t}\n");
+	free(sigs);
+	if (r < 0)
+		return -1;
+	writer_puts(c, "\tdefault:\n\t\treturn -1;\n\t}\n");
 	return 0;
 }
 
-static int msg_data_type(FILE *c, can_msg_t *msg, bool data, dbc2c_options_t *copts)
+static int msg_data_type(writer_t *c, can_msg_t *msg, bool data, dbc2c_options_t *copts)
 {
 	assert(c);
 	assert(msg);
 	assert(copts);
 	char name[MAX_NAME_LENGTH] = {0};
 	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
-	return fprintf(c, "\t%s_t %s%s;\n", name, name, data ? "_data" : "");
+	if (copts->use_lazy_decoding && !data)
+		return writer_printf(c, "\t%s%s %s; /* payload */\n",
+				copts->use_cache_line_layout ? "DBCC_CACHE_ALIGN " : "", msg_payload_type(msg), name);
+	return writer_printf(c, "\t%s%s_t %s%s;\n",
+			copts->use_cache_line_layout ? "DBCC_CACHE_ALIGN " : "",
+			name, name, data ? "_data" : "");
+}
+
+
+static int msg_data_type_bitfields(writer_t *c, can_msg_t *msg, dbc2c_options_t *copts) {
+	assert(c);
+	assert(msg);
+	assert(copts);
+	char name[MAX_NAME_LENGTH] = {0};
+	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
+	writer_printf(c, "\tunsigned %s_status : 2;\n", name); /* uninitialized, present, faulty (range/crc/timeout/other) */
+	writer_printf(c, "\tunsigned %s_tx : 1;\n", name); /* have we packed this message? */
+	if (copts->use_dirty_tracking)
+		writer_printf(c, "\tunsigned %s_dirty : 1;\n", name); /* has a signal been changed since it was packed? */
+	return writer_printf(c, "\tunsigned %s_rx : 1;\n", name); /* have we unpacked this message? */
 }
 
+static int msg_data_type_time_stamp(writer_t *c, can_msg_t *msg, dbc2c_options_t *copts) {
+	assert(c);
+	assert(msg);
+	assert(copts);
+	char name[MAX_NAME_LENGTH] = {0};
+	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
+	return writer_printf(c, "\tdbcc_time_stamp_t %s_time_stamp_rx;\n", name);
+}
 
-static int msg_data_type_bitfields(FILE *c, can_msg_t *msg, dbc2c_options_t *copts) {
+static int msg_data_type_changes(writer_t *c, can_msg_t *msg, dbc2c_options_t *copts) {
 	assert(c);
 	assert(msg);
 	assert(copts);
+	if (!copts->use_change_detection)
+		return 0;
 	char name[MAX_NAME_LENGTH] = {0};
 	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
-	fprintf(c, "\tunsigned %s_status : 2;\n", name); /* uninitialized, present, faulty (range/crc/timeout/other) */
-	fprintf(c, "\tunsigned %s_tx : 1;\n", name); /* have we packed this message? */
-	return fprintf(c, "\tunsigned %s_rx : 1;\n", name); /* have we unpacked this message? */
+	if (!copts->use_lazy_decoding)
+		writer_printf(c, "\tuint64_t %s_raw; /* payload last unpacked */\n", name);
+	return writer_printf(c, "\tuint64_t %s_changed; /* %s_CHANGED_* bits, signals changed by the last unpack */\n", name, name);
 }
 
-static int msg_data_type_time_stamp(FILE *c, can_msg_t *msg, dbc2c_options_t *copts) {
+static int msg_data_type_seqlock(writer_t *c, can_msg_t *msg, dbc2c_options_t *copts) {
 	assert(c);
 	assert(msg);
 	assert(copts);
+	if (!copts->use_seqlock)
+		return 0;
 	char name[MAX_NAME_LENGTH] = {0};
 	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
-	return fprintf(c, "\tdbcc_time_stamp_t %s_time_stamp_rx;\n", name);
+	return writer_printf(c, "\tdbcc_seq_t %s_seq;\n", name);
+}
+
+/* 'register' is not allowed in C++17, which a header might be compiled as */
+static const char *storage_class(dbc2c_options_t *copts)
+{
+	assert(copts);
+	return copts->generate_inline ? "" : "register ";
 }
 
-static int msg_pack(can_msg_t *msg, FILE *c, const char *name, bool motorola_used, bool intel_used, const char *god, dbc2c_options_t *copts)
+static void msg_endianess(can_msg_t *msg, bool *motorola_used, bool *intel_used)
+{
+	assert(msg);
+	assert(motorola_used);
+	assert(intel_used);
+	*motorola_used = false;
+	*intel_used = false;
+	for (size_t i = 0; i < msg->signal_count; i++)
+		if (msg->sigs[i]->endianess == endianess_motorola_e)
+			*motorola_used = true;
+		else
+			*intel_used = true;
+}
+
+static int msg_pack(can_msg_t *msg, writer_t *c, const char *name, bool motorola_used, bool intel_used, const char *god, bool hot, dbc2c_options_t *copts)
 {
 	assert(msg);
 	assert(c);
 	assert(name);
 	assert(copts);
 	const bool message_has_signals = motorola_used || intel_used;
-	print_function_name(c, "pack", name, " {\n", false, "uint64_t", false, god);
+	print_function_name(c, "pack", name, " {\n", false, "uint64_t", false, god, hot);
 	if (copts->generate_asserts) {
-		fprintf(c, "\tassert(o);\n");
-		fprintf(c, "\tassert(data);\n");
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(data);\n");
+	}
+	if (copts->use_lazy_decoding) {
+		writer_printf(c, "\t*data = o->%s;\n", name);
+		writer_printf(c, "\to->%s_tx = 1;\n", name);
+		if (copts->use_dirty_tracking)
+			writer_printf(c, "\to->%s_dirty = 0;\n", name);
+		return writer_puts(c, "\treturn 0;\n}\n\n");
 	}
 	if (message_has_signals)
-		fprintf(c, "\tregister uint64_t x;\n");
+		writer_printf(c, "\t%suint64_t x;\n", storage_class(copts));
 	if (motorola_used)
-		fprintf(c, "\tregister uint64_t m = 0;\n");
+		writer_printf(c, "\t%suint64_t m = 0;\n", storage_class(copts));
 	if (intel_used)
-		fprintf(c, "\tregister uint64_t i = 0;\n");
+		writer_printf(c, "\t%suint64_t i = 0;\n", storage_class(copts));
 	if (!message_has_signals)
-		fprintf(c, "\tUNUSED(o);\n\tUNUSED(data);\n");
-	signal_t *multiplexor = process_signals_and_find_multiplexer(msg, c, name, true);
+		writer_puts(c, "\tUNUSED(o);\n\tUNUSED(data);\n");
+	signal_t *multiplexor = process_signals_and_find_multiplexer(msg, c, name, signal2serializer, copts);
 
-	if (multiplexor)
-		if (multiplexor_switch(msg, multiplexor, c, name, true) < 0)
+	if (multiplexor) {
+		char selector[MAX_NAME_LENGTH * 2] = {0};
+		snprintf(selector, sizeof selector, "o->%s.%s", name, multiplexor->name);
+		if (multiplexor_switch(msg, selector, c, name, signal2serializer, copts) < 0)
 			return -1;
+	}
 
 	if (message_has_signals) {
-		fprintf(c, "\t*data = %s%s%s%s%s;\n",
+		writer_printf(c, "\t*data = %s%s%s%s%s;\n",
 			swap_motorola && motorola_used ? "reverse_byte_order" : "",
 			motorola_used ? "(m)" : "",
 			motorola_used && intel_used ? "|" : "",
 			(!swap_motorola && intel_used) ? "reverse_byte_order" : "",
 			intel_used ? "(i)" : "");
 	}
-	fprintf(c, "\to->%s_tx = 1;\n", name);
-	fprintf(c, "\treturn 0;\n}\n\n");
+	writer_printf(c, "\to->%s_tx = 1;\n", name);
+	if (copts->use_dirty_tracking)
+		writer_printf(c, "\to->%s_dirty = 0;\n", name);
+	writer_puts(c, "\treturn 0;\n}\n\n");
 	return 0;
 }
 
-static int msg_unpack(can_msg_t *msg, FILE *c, const char *name, bool motorola_used, bool intel_used, const char *god, dbc2c_options_t *copts)
+/* Change detection; with '-d' unpack returns straight away, only updating the
+ * time stamp, if the payload is the same as the one last unpacked for the
+ * message. Otherwise a bit is set for each signal, in the order they are in
+ * the message structure, whose bits in the payload differ. Signals after the
+ * 64th share the last bit. A multiplexed signal is marked as changed if its
+ * bits are, whichever signals are multiplexed into them. */
+/* the bit of a '_changed' field for the i'th signal of a message */
+static unsigned change_bit(size_t i)
+{
+	return i < 63 ? i : 63;
+}
+
+static int msg_changes(can_msg_t *msg, writer_t *c, const char *name, dbc2c_options_t *copts)
+{
+	assert(msg);
+	assert(c);
+	assert(name);
+	assert(copts);
+	const char *raw = copts->use_lazy_decoding ? "" : "_raw";
+	char payload[MAX_NAME_LENGTH] = "data";
+	if (copts->use_lazy_decoding)
+		snprintf(payload, sizeof payload, "(%s)data", msg_payload_type(msg));
+	writer_printf(c, "\tif (o->%s_rx && o->%s%s == %s) {\n", name, name, raw, payload);
+	writer_printf(c, "\t\to->%s_changed = 0;\n", name);
+	writer_printf(c, "\t\to->%s_time_stamp_rx = time_stamp;\n", name);
+	writer_puts(c, "\t\treturn 0;\n\t}\n");
+	writer_printf(c, "\tconst uint64_t diff = o->%s_rx ? %s ^ o->%s%s : UINT64_MAX;\n", name, payload, name, raw);
+	writer_puts(c, "\tuint64_t changed = 0;\n");
+	for (size_t i = 0; i < msg->signal_count; i++)
+		writer_printf(c, "\tchanged |= (uint64_t)((diff & UINT64_C(0x%016" PRIx64 ")) != 0) << %u;\n",
+				signal_payload_bits(msg->sigs[i]), change_bit(i));
+	return 0;
+}
+
+/* Seqlocks; with '-l' each message has a sequence number that unpack makes
+ * odd while it writes the message and even again when it is done. A reader
+ * copies the message out and tries again if the number was odd or changed
+ * while it was copying, so the single writer never waits for readers and
+ * readers never see half of an update. The unpack function for a message
+ * wraps the usual one, which can return early. */
+static int msg_unpack_seqlock(writer_t *c, const char *name, const char *god, bool hot)
+{
+	assert(c);
+	assert(name);
+	assert(god);
+	writer_printf(c, "static %sint unpack_unlocked_%s_%s(can_%s_t *o, uint64_t data, uint8_t dlc, dbcc_time_stamp_t time_stamp);\n\n", "inline ", god, name, god);
+	print_function_name(c, "unpack", name, " {\n", true, "uint64_t", true, god, hot);
+	writer_printf(c, "\tconst unsigned seq = atomic_load_explicit(&o->%s_seq, memory_order_relaxed);\n", name);
+	writer_printf(c, "\tatomic_store_explicit(&o->%s_seq, seq + 1u, memory_order_relaxed);\n", name);
+	writer_puts(c, "\tatomic_thread_fence(memory_order_release);\n");
+	writer_printf(c, "\tconst int r = unpack_unlocked_%s_%s(o, data, dlc, time_stamp);\n", god, name);
+	writer_printf(c, "\tatomic_store_explicit(&o->%s_seq, seq + 2u, memory_order_release);\n", name);
+	return writer_puts(c, "\treturn r;\n}\n\n");
+}
+
+static int msg_snapshot_function_name(writer_t *c, const char *name, const char *god, const char *postfix)
+{
+	assert(c);
+	assert(name);
+	assert(god);
+	assert(postfix);
+	return writer_printf(c, "int candb_snapshot_%s_%s(const can_%s_t *o, can_%s_t *copy)%s", god, name, god, god, postfix);
+}
+
+/* copy the data, time stamp and received flag of a message into another
+ * object, which the decode functions can then be used on; 'o' is const so
+ * that a read only mapping can be passed, but C11 atomic loads do not take
+ * const objects so the sequence number is cast */
+static int msg_snapshot(writer_t *c, const char *name, const char *god, dbc2c_options_t *copts)
+{
+	assert(c);
+	assert(name);
+	assert(god);
+	assert(copts);
+	msg_snapshot_function_name(c, name, god, " {\n");
+	if (copts->generate_asserts) {
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(copy);\n");
+	}
+	writer_puts(c, "\tfor (;;) {\n");
+	writer_printf(c, "\t\tconst unsigned seq = atomic_load_explicit((dbcc_seq_t *)&o->%s_seq, memory_order_acquire);\n", name);
+	writer_puts(c, "\t\tif (seq & 1u)\n\t\t\tcontinue;\n");
+	writer_printf(c, "\t\tcopy->%s = o->%s;\n", name, name);
+	writer_printf(c, "\t\tcopy->%s_time_stamp_rx = o->%s_time_stamp_rx;\n", name, name);
+	writer_printf(c, "\t\tcopy->%s_rx = o->%s_rx;\n", name, name);
+	if (copts->use_change_detection) {
+		if (!copts->use_lazy_decoding)
+			writer_printf(c, "\t\tcopy->%s_raw = o->%s_raw;\n", name, name);
+		writer_printf(c, "\t\tcopy->%s_changed = o->%s_changed;\n", name, name);
+	}
+	writer_puts(c, "\t\tatomic_thread_fence(memory_order_acquire);\n");
+	writer_printf(c, "\t\tif (atomic_load_explicit((dbcc_seq_t *)&o->%s_seq, memory_order_relaxed) == seq)\n", name);
+	writer_printf(c, "\t\t\treturn copy->%s_rx ? 0 : -1;\n", name);
+	writer_puts(c, "\t}\n");
+	return writer_puts(c, "}\n\n");
+}
+
+static int msg_unpack(can_msg_t *msg, writer_t *c, const char *name, bool motorola_used, bool intel_used, const char *god, bool hot, dbc2c_options_t *copts)
 {
 	assert(msg);
 	assert(c);
 	assert(name);
 	assert(copts);
 	const bool message_has_signals = motorola_used || intel_used;
-	print_function_name(c, "unpack", name, " {\n", true, "uint64_t", true, god);
+	if (copts->use_seqlock && msg_unpack_seqlock(c, name, god, hot) < 0)
+		return -1;
+	print_function_name(c, copts->use_seqlock ? "unpack_unlocked" : "unpack", name, " {\n", true, "uint64_t", true, god, hot || copts->use_seqlock);
 	if (copts->generate_asserts) {
-		fprintf(c, "\tassert(o);\n");
-		fprintf(c, "\tassert(dlc <= 8);\n");
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(dlc <= 8);\n");
 	}
-	if (message_has_signals)
-		fprintf(c, "\tregister uint64_t x;\n");
-	if (motorola_used)
-		fprintf(c, "\tregister uint64_t m = %s(data);\n", swap_motorola ? "reverse_byte_order" : "");
-	if (intel_used)
-		fprintf(c, "\tregister uint64_t i = %s(data);\n", swap_motorola ? "" : "reverse_byte_order");
-	if (!message_has_signals)
-		fprintf(c, "\tUNUSED(o);\n\tUNUSED(data);\n");
+	if (motorola_used && !copts->use_lazy_decoding)
+		writer_printf(c, "\t%suint64_t m = %s(data);\n", storage_class(copts), swap_motorola ? "reverse_byte_order" : "");
+	if (intel_used && !copts->use_lazy_decoding)
+		writer_printf(c, "\t%suint64_t i = %s(data);\n", storage_class(copts), swap_motorola ? "" : "reverse_byte_order");
+	if (!message_has_signals && !copts->use_lazy_decoding)
+		writer_puts(c, "\tUNUSED(o);\n\tUNUSED(data);\n");
 	if (msg->dlc)
-		fprintf(c, "\tif (dlc < %u)\n\t\treturn -1;\n", msg->dlc);
+		writer_printf(c, "\tif (dlc < %u)\n\t\treturn -1;\n", msg->dlc);
 	else
-		fprintf(c, "\tUNUSED(dlc);\n");
+		writer_puts(c, "\tUNUSED(dlc);\n");
+	const bool detect = copts->use_change_detection && message_has_signals;
+	if (detect && msg_changes(msg, c, name, copts) < 0)
+		return -1;
 
-	signal_t *multiplexor = process_signals_and_find_multiplexer(msg, c, name, false);
-	if (multiplexor)
-		if (multiplexor_switch(msg, multiplexor, c, name, false) < 0)
+	if (copts->use_lazy_decoding) {
+		writer_printf(c, "\to->%s = data;\n", name);
+		if (detect)
+			writer_printf(c, "\to->%s_changed = changed;\n", name);
+		writer_printf(c, "\to->%s_rx = 1;\n", name);
+		writer_printf(c, "\to->%s_time_stamp_rx = time_stamp;\n", name);
+		return writer_puts(c, "\treturn 0;\n}\n\n");
+	}
+
+	signal_t *multiplexor = process_signals_and_find_multiplexer(msg, c, name, signal2deserializer, copts);
+	if (multiplexor) {
+		char selector[MAX_NAME_LENGTH * 2] = {0};
+		snprintf(selector, sizeof selector, "o->%s.%s", name, multiplexor->name);
+		if (multiplexor_switch(msg, selector, c, name, signal2deserializer, copts) < 0)
 			return -1;
-	fprintf(c, "\to->%s_rx = 1;\n", name);
-	fprintf(c, "\to->%s_time_stamp_rx = time_stamp;\n", name);
-	fprintf(c, "\treturn 0;\n}\n\n");
+	}
+	if (detect) {
+		writer_printf(c, "\to->%s_raw = data;\n", name);
+		writer_printf(c, "\to->%s_changed = changed;\n", name);
+	}
+	writer_printf(c, "\to->%s_rx = 1;\n", name);
+	writer_printf(c, "\to->%s_time_stamp_rx = time_stamp;\n", name);
+	writer_puts(c, "\treturn 0;\n}\n\n");
 	return 0;
 }
 
-static int msg_print(can_msg_t *msg, FILE *c, const char *name, const char *god, dbc2c_options_t *copts)
+static int msg_physical_function_name(writer_t *c, const char *name, bool unpack, const char *god, const char *postfix)
+{
+	assert(c);
+	assert(name);
+	assert(god);
+	assert(postfix);
+	if (unpack)
+		return writer_printf(c, "int candb_unpack_physical_%s_%s(%s_physical_t *p, uint64_t data, uint8_t dlc)%s", god, name, name, postfix);
+	return writer_printf(c, "int candb_pack_physical_%s_%s(const %s_physical_t *p, uint64_t *data)%s", god, name, name, postfix);
+}
+
+/* Unpack or pack a message straight from or to the physical values of its
+ * signals, in one pass and without going through the message structure */
+static int msg_physical(can_msg_t *msg, writer_t *c, const char *name, bool unpack, bool motorola_used, bool intel_used, const char *god, dbc2c_options_t *copts)
+{
+	assert(msg);
+	assert(c);
+	assert(name);
+	assert(god);
+	assert(copts);
+	const bool message_has_signals = motorola_used || intel_used;
+	const signal_codec_f codec = unpack ? signal2physical_decode : signal2physical_encode;
+	msg_physical_function_name(c, name, unpack, god, " {\n");
+	if (copts->generate_asserts) {
+		writer_puts(c, "\tassert(p);\n");
+		writer_puts(c, unpack ? "\tassert(dlc <= 8);\n" : "\tassert(data);\n");
+	}
+	if (message_has_signals)
+		writer_puts(c, "\tregister uint64_t x;\n");
+	if (unpack) {
+		if (motorola_used)
+			writer_printf(c, "\tregister uint64_t m = %s(data);\n", swap_motorola ? "reverse_byte_order" : "");
+		if (intel_used)
+			writer_printf(c, "\tregister uint64_t i = %s(data);\n", swap_motorola ? "" : "reverse_byte_order");
+	} else {
+		if (motorola_used)
+			writer_puts(c, "\tregister uint64_t m = 0;\n");
+		if (intel_used)
+			writer_puts(c, "\tregister uint64_t i = 0;\n");
+	}
+	if (find_multiplexor(msg))
+		writer_puts(c, "\tuint64_t mux = 0;\n");
+	if (unpack)
+		writer_puts(c, "\tint r = 0;\n");
+	if (!message_has_signals)
+		writer_puts(c, "\tUNUSED(p);\n\tUNUSED(data);\n");
+	if (unpack) {
+		if (msg->dlc)
+			writer_printf(c, "\tif (dlc < %u)\n\t\treturn -1;\n", msg->dlc);
+		else
+			writer_puts(c, "\tUNUSED(dlc);\n");
+	}
+
+	signal_t *multiplexor = process_signals_and_find_multiplexer(msg, c, name, codec, copts);
+	if (multiplexor)
+		if (multiplexor_switch(msg, "mux", c, name, codec, copts) < 0)
+			return -1;
+
+	if (unpack)
+		return writer_puts(c, "\treturn r;\n}\n\n");
+	if (message_has_signals) {
+		writer_printf(c, "\t*data = %s%s%s%s%s;\n",
+			swap_motorola && motorola_used ? "reverse_byte_order" : "",
+			motorola_used ? "(m)" : "",
+			motorola_used && intel_used ? "|" : "",
+			(!swap_motorola && intel_used) ? "reverse_byte_order" : "",
+			intel_used ? "(i)" : "");
+	}
+	return writer_puts(c, "\treturn 0;\n}\n\n");
+}
+
+static int msg_print(can_msg_t *msg, writer_t *c, const char *name, const char *god, dbc2c_options_t *copts)
 {
 	assert(msg);
 	assert(c);
 	assert(name);
 	assert(god);
 	assert(copts);
-	fprintf(c, "int print_%s(const can_%s_t *o, FILE *output) {\n", name, god);
+	writer_printf(c, "int print_%s(const can_%s_t *o, FILE *output) {\n", name, god);
 	if (copts->generate_asserts) {
-		fputs("\tassert(o);\n", c);
-		fputs("\tassert(output);\n", c);
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(output);\n");
 		/* you may note the UNUSED macro may be generated, we should
 		 * still assert we are passed the correct things */
 	}
 	if (msg->signal_count)
-		fprintf(c, "\tint r = 0;\n"); //fprintf(c, "\tdouble scaled;\n\tint r = 0;\n");
+		writer_puts(c, "\tint r = 0;\n"); //fprintf(c, "\tdouble scaled;\n\tint r = 0;\n");
 	else
-		fprintf(c, "\tUNUSED(o);\n\tUNUSED(output);\n");
+		writer_puts(c, "\tUNUSED(o);\n\tUNUSED(output);\n");
 	for (size_t i = 0; i < msg->signal_count; i++) {
-		if (signal2print(msg->sigs[i], msg->id, name, c) < 0)
+		if (signal2print(msg->sigs[i], msg->id, name, c, copts) < 0)
 			return -1;
 	}
 	if (msg->signal_count)
-		fprintf(c, "\treturn r;\n}\n\n");
+		writer_puts(c, "\treturn r;\n}\n\n");
 	else
-		fprintf(c, "\treturn 0;\n}\n\n");
+		writer_puts(c, "\treturn 0;\n}\n\n");
 	return 0;
 }
 
@@ -686,116 +1680,832 @@ static int msg_dlc_check(can_msg_t *msg) {
 		signal_t *s = msg->sigs[i];
 		used += s->bit_length;
 	}
-	if (used > bits) {
-		warning("Too many signals, not enough bytes (DLC is too low, fix your DBC file): %s", msg->name);
-		return -1;
+	if (used > bits) {
+		warning("Too many signals, not enough bytes (DLC is too low, fix your DBC file): %s", msg->name);
+		return -1;
+	}
+	return 0;
+}
+
+/* the pack, unpack, encode and decode functions for a message, which go in
+ * the header with '-i' */
+static int msg_codec(can_msg_t *msg, writer_t *c, const char *name, bool motorola_used, bool intel_used, const char *god, bool hot, dbc2c_options_t *copts)
+{
+	assert(msg);
+	assert(c);
+	assert(name);
+	assert(copts);
+	if (copts->generate_pack && msg_pack(msg, c, name, motorola_used, intel_used, god, hot, copts) < 0)
+		return -1;
+
+	if (copts->generate_unpack && msg_unpack(msg, c, name, motorola_used, intel_used, god, hot, copts) < 0)
+		return -1;
+
+	for (size_t i = 0; i < msg->signal_count; i++) {
+		if (copts->generate_unpack)
+			if (signal2scaling(name, msg->id, msg->sigs[i], c, true, false, god, copts) < 0)
+				return -1;
+		if (copts->generate_pack)
+			if (signal2scaling(name, msg->id, msg->sigs[i], c, false, false, god, copts) < 0)
+				return -1;
+	}
+	return 0;
+}
+
+static int msg2c(can_msg_t *msg, writer_t *c, dbc2c_options_t *copts, char *god, bool hot)
+{
+	assert(msg);
+	assert(c);
+	assert(copts);
+	assert(god);
+	char name[MAX_NAME_LENGTH] = {0};
+	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
+	bool motorola_used = false, intel_used = false;
+	msg_endianess(msg, &motorola_used, &intel_used);
+
+	/* sanity checks against messages should go here, we could check for;
+	 * - odd min/max values given scaling
+	 * - duplicate signals and messages
+	 * They really should go into a semantic analysis phase after reading
+	 * in the DBC file and parsing it. Oh Well. */
+	msg_dlc_check(msg);
+	for (size_t i = 0; i < msg->signal_count; i++)
+		signal_float_check(msg->name, msg->sigs[i], copts);
+
+	if (!copts->generate_inline && msg_codec(msg, c, name, motorola_used, intel_used, god, hot, copts) < 0)
+		return -1;
+
+	if (copts->generate_print && msg_print(msg, c, name, god, copts) < 0)
+		return -1;
+
+	if (copts->generate_extract && msg2extract(msg, c, false, god, copts) < 0)
+		return -1;
+
+	if (copts->use_seqlock && copts->generate_unpack && msg_snapshot(c, name, god, copts) < 0)
+		return -1;
+
+	if (copts->generate_physical) {
+		if (copts->generate_unpack && msg_physical(msg, c, name, true, motorola_used, intel_used, god, copts) < 0)
+			return -1;
+		if (copts->generate_pack && msg_physical(msg, c, name, false, motorola_used, intel_used, god, copts) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int msg2h(can_msg_t *msg, writer_t *h, dbc2c_options_t *copts, const char *god)
+{
+	assert(msg);
+	assert(h);
+	assert(copts);
+	assert(god);
+	char name[MAX_NAME_LENGTH] = {0};
+	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
+
+	if (copts->generate_inline) {
+		bool motorola_used = false, intel_used = false;
+		msg_endianess(msg, &motorola_used, &intel_used);
+		if (msg_codec(msg, h, name, motorola_used, intel_used, god, true, copts) < 0)
+			return -1;
+	}
+
+	for (size_t i = 0; i < msg->signal_count && !copts->generate_inline; i++) {
+		if (copts->generate_unpack)
+			if (signal2scaling(name, msg->id, msg->sigs[i], h, true, true, god, copts) < 0)
+				return -1;
+		if (copts->generate_pack)
+			if (signal2scaling(name, msg->id, msg->sigs[i], h, false, true, god, copts) < 0)
+				return -1;
+	}
+	if (copts->generate_extract && msg2extract(msg, h, true, god, copts) < 0)
+		return -1;
+	if (copts->use_seqlock && copts->generate_unpack)
+		msg_snapshot_function_name(h, name, god, ";\n");
+	if (copts->generate_physical) {
+		if (copts->generate_unpack)
+			msg_physical_function_name(h, name, true, god, ";\n");
+		if (copts->generate_pack)
+			msg_physical_function_name(h, name, false, god, ";\n");
+	}
+	writer_puts(h, "\n\n");
+	return 0;
+}
+
+static const char *cfunctions =
+"static inline uint64_t reverse_byte_order(uint64_t x) {\n"
+"\tx = (x & 0x00000000FFFFFFFF) << 32 | (x & 0xFFFFFFFF00000000) >> 32;\n"
+"\tx = (x & 0x0000FFFF0000FFFF) << 16 | (x & 0xFFFF0000FFFF0000) >> 16;\n"
+"\tx = (x & 0x00FF00FF00FF00FF) << 8  | (x & 0xFF00FF00FF00FF00) >> 8;\n"
+"\treturn x;\n"
+"}\n\n";
+static const char *cfunctions_bytes =
+"#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)\n"
+"static inline uint64_t dbcc_load_le64(const uint8_t *b) {\n"
+"\tuint64_t x;\n"
+"\tmemcpy(&x, b, sizeof x);\n"
+"\treturn x;\n"
+"}\n\n"
+"static inline void dbcc_store_le64(uint8_t *b, uint64_t x) {\n"
+"\tmemcpy(b, &x, sizeof x);\n"
+"}\n"
+"#else\n"
+"static inline uint64_t dbcc_load_le64(const uint8_t *b) {\n"
+"\tuint64_t x = 0;\n"
+"\tfor (int i = 7; i >= 0; i--)\n"
+"\t\tx = (x << 8) | b[i];\n"
+"\treturn x;\n"
+"}\n\n"
+"static inline void dbcc_store_le64(uint8_t *b, uint64_t x) {\n"
+"\tfor (int i = 0; i < 8; i++, x >>= 8)\n"
+"\t\tb[i] = x;\n"
+"}\n"
+"#endif\n\n";
+
+static const char *cfunctions_print_only =
+"static inline int print_helper(int r, int print_return_value) {\n"
+"\treturn ((r >= 0) && (print_return_value >= 0)) ? r + print_return_value : -1;\n"
+"}\n\n";
+
+/* Static functions used by the generated code. When they are put in the
+ * header, for '-i', each one is guarded so that the headers for several DBC
+ * files can be included in one file. */
+static int helper(writer_t *o, const char *guard, const char *text)
+{
+	assert(o);
+	assert(text);
+	if (!guard)
+		return writer_puts(o, text);
+	writer_printf(o, "#ifndef %s\n#define %s\n", guard, guard);
+	writer_puts(o, text);
+	return writer_puts(o, "#endif\n\n");
+}
+
+static int helpers(writer_t *o, dbc_t *dbc, dbc2c_options_t *copts, bool header)
+{
+	assert(o);
+	assert(dbc);
+	assert(copts);
+	if (helper(o, header ? "DBCC_REVERSE_BYTE_ORDER" : NULL, cfunctions) < 0)
+		return -1;
+	if (copts->generate_unpack || copts->generate_pack)
+		if (helper(o, header ? "DBCC_LOAD_LE64" : NULL, cfunctions_bytes) < 0)
+			return -1;
+	if (!dbc->use_float)
+		return 0;
+	if (copts->generate_unpack || copts->generate_extract || copts->generate_pack || copts->use_lazy_decoding)
+		if (writer_puts(o, float_detect) < 0)
+			return -1;
+	if (copts->generate_unpack || copts->generate_extract || copts->use_lazy_decoding)
+		if (helper(o, header ? "DBCC_UNPACK754" : NULL, float_unpack) < 0)
+			return -1;
+	if (copts->generate_pack || copts->use_lazy_decoding)
+		if (helper(o, header ? "DBCC_PACK754" : NULL, float_pack) < 0)
+			return -1;
+	return 0;
+}
+
+static const char *cfunctions_builtin =
+"#if defined(__GNUC__) || defined(__clang__)\n"
+"static inline uint64_t reverse_byte_order(uint64_t x) {\n"
+"\treturn __builtin_bswap64(x);\n"
+"}\n\n"
+"#elif defined(_MSC_VER)\n"
+"static inline uint64_t reverse_byte_order(uint64_t x) {\n"
+"\treturn _byteswap_uint64(x);\n"
+"}\n\n"
+"#else\n";
+
+/* The runtime header has every helper the generated code might use, with
+ * the byte swap done by a compiler intrinsic where there is one, so that
+ * a program using the code generated for many DBC files with '-r' has
+ * one set of helpers. The guards are the same as those used for '-i'. */
+int dbc2c_runtime(writer_t *h)
+{
+	assert(h);
+	writer_puts(h, "/** CAN message encoder/decoder run time: automatically generated - do not edit\n");
+	writer_puts(h, "  * Generated by dbcc: See https://github.com/howerj/dbcc */\n");
+	writer_puts(h, "#ifndef DBCC_RUNTIME_H\n");
+	writer_puts(h, "#define DBCC_RUNTIME_H\n\n");
+	writer_puts(h, "#include <stdint.h>\n");
+	writer_puts(h, "#include <float.h>\n");
+	writer_puts(h, "#include <math.h>\n");
+	writer_puts(h, "#include <string.h>\n");
+	writer_puts(h, "#ifdef _MSC_VER\n#include <stdlib.h>\n#endif\n\n");
+	writer_puts(h, "#ifndef DBCC_REVERSE_BYTE_ORDER\n#define DBCC_REVERSE_BYTE_ORDER\n");
+	writer_puts(h, cfunctions_builtin);
+	writer_puts(h, cfunctions);
+	writer_puts(h, "#endif\n#endif\n\n");
+	helper(h, "DBCC_LOAD_LE64", cfunctions_bytes);
+	helper(h, "DBCC_PRINT_HELPER", cfunctions_print_only);
+	writer_puts(h, float_detect);
+	helper(h, "DBCC_UNPACK754", float_unpack);
+	helper(h, "DBCC_PACK754", float_pack);
+	return writer_puts(h, "#endif\n");
+}
+
+static int message_compare_function(const void *a, const void *b)
+{
+	assert(a);
+	assert(b);
+	can_msg_t *ap = *((can_msg_t**)a);
+	can_msg_t *bp = *((can_msg_t**)b);
+	if (ap->id <  bp->id) return -1;
+	if (ap->id == bp->id) return  0;
+	if (ap->id >  bp->id) return  1;
+	return 0;
+}
+
+static int signal_compare_function(const void *a, const void *b)
+{
+	assert(a);
+	assert(b);
+	signal_t *ap = *((signal_t**)a);
+	signal_t *bp = *((signal_t**)b);
+	if (ap->bit_length <  bp->bit_length) return  1;
+	if (ap->bit_length == bp->bit_length) return  0;
+	if (ap->bit_length >  bp->bit_length) return -1;
+	return 0;
+}
+
+/* The generator orders the messages by identifier and the signals by size,
+ * this is done on a copy of the message and signal lists so the model itself
+ * is left as it was parsed and can be used for other outputs afterwards. */
+static dbc_t *dbc_sorted_copy(dbc_t *dbc)
+{
+	assert(dbc);
+	dbc_t *d = allocate(sizeof(*d));
+	*d = *dbc;
+	d->messages = allocate(sizeof(*d->messages) * (dbc->message_count + 1));
+	for (size_t i = 0; i < dbc->message_count; i++) {
+		can_msg_t *msg = allocate(sizeof(*msg));
+		*msg = *dbc->messages[i];
+		msg->sigs = allocate(sizeof(*msg->sigs) * (msg->signal_count + 1));
+		memcpy(msg->sigs, dbc->messages[i]->sigs, sizeof(*msg->sigs) * msg->signal_count);
+		qsort(msg->sigs, msg->signal_count, sizeof(msg->sigs[0]), signal_compare_function);
+		d->messages[i] = msg;
+	}
+	qsort(d->messages, d->message_count, sizeof(d->messages[0]), message_compare_function);
+	return d;
+}
+
+static void dbc_sorted_delete(dbc_t *d)
+{
+	if (!d)
+		return;
+	for (size_t i = 0; i < d->message_count; i++) {
+		free(d->messages[i]->sigs);
+		free(d->messages[i]);
+	}
+	free(d->messages);
+	free(d);
+}
+
+/* Profile guided dispatch; the identifiers that carry most of the traffic,
+ * according to a frame frequency profile, are checked before the switch (or
+ * table) and their pack/unpack functions are made inline so the compiler can
+ * fold them into the dispatch function. */
+#define MAX_HOT_MESSAGES (8u)
+
+typedef struct {
+	size_t count;                         /**< number of hot messages */
+	can_msg_t *msgs[MAX_HOT_MESSAGES];    /**< hottest message first */
+	double share[MAX_HOT_MESSAGES];       /**< fraction of all frames */
+} hot_t;
+
+static int frame_count_compare_function(const void *a, const void *b)
+{
+	assert(a);
+	assert(b);
+	const frame_count_t *ap = a;
+	const frame_count_t *bp = b;
+	if (ap->count > bp->count) return -1;
+	if (ap->count < bp->count) return  1;
+	if (ap->id < bp->id) return -1;
+	if (ap->id > bp->id) return  1;
+	return 0;
+}
+
+/* The hot messages are the most frequent ones, up to MAX_HOT_MESSAGES of
+ * them, that each have at least 1% of the frames in the profile. */
+static void hot_messages(dbc_t *dbc, hot_t *hot, dbc2c_options_t *copts)
+{
+	assert(dbc);
+	assert(hot);
+	assert(copts);
+	hot->count = 0;
+	if (!copts->profile_count)
+		return;
+	uint64_t total = 0;
+	frame_count_t *sorted = allocate(sizeof(*sorted) * copts->profile_count);
+	for (size_t i = 0; i < copts->profile_count; i++) {
+		sorted[i] = copts->profile[i];
+		total += sorted[i].count;
+	}
+	qsort(sorted, copts->profile_count, sizeof(*sorted), frame_count_compare_function);
+	for (size_t i = 0; i < copts->profile_count && hot->count < MAX_HOT_MESSAGES; i++) {
+		if (!total || sorted[i].count * 100 < total)
+			break;
+		for (size_t j = 0; j < dbc->message_count; j++) {
+			if (dbc->messages[j]->id != sorted[i].id)
+				continue;
+			hot->msgs[hot->count]  = dbc->messages[j];
+			hot->share[hot->count] = (double)sorted[i].count / total;
+			hot->count++;
+			break;
+		}
+	}
+	free(sorted);
+}
+
+static bool is_hot(const hot_t *hot, const can_msg_t *msg)
+{
+	assert(hot);
+	assert(msg);
+	for (size_t i = 0; i < hot->count; i++)
+		if (hot->msgs[i] == msg)
+			return true;
+	return false;
+}
+
+static int hot_dispatch(writer_t *c, const hot_t *hot, const char *function, bool dlc, const char *god, dbc2c_options_t *copts)
+{
+	assert(c);
+	assert(hot);
+	assert(function);
+	assert(god);
+	assert(copts);
+	for (size_t i = 0; i < hot->count; i++) {
+		can_msg_t *msg = hot->msgs[i];
+		char name[MAX_NAME_LENGTH] = {0};
+		make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
+		writer_puts(c, "\tif (id == 0x");
+		writer_hex(c, msg->id, 3);
+		writer_printf(c, ") /* %.1f%% of frames */\n", hot->share[i] * 100.0);
+		writer_printf(c, "\t\treturn %s_%s_%s(o, data%s);\n", function, god, name, dlc ? ", dlc, time_stamp" : "");
+	}
+	return 0;
+}
+
+/* The message dispatch is done by a 'static inline' function in the C file,
+ * 'candb_<name>_<function>_dispatch', which is made either by
+ * 'switch_function' or 'table_function'. The functions in the API wrap it,
+ * one for a single frame and one for a batch of frames, so the checks on the
+ * arguments are done once per call and not once per frame. */
+static int dispatch_name(writer_t *c, const char *function, bool unpack, const char *datatype, bool dlc, const char *god, bool internal)
+{
+	assert(c);
+	assert(function);
+	assert(datatype);
+	assert(god);
+	return writer_printf(c, "%sint candb_%s_%s_%s(can_%s_t *o, const unsigned long id, %s %sdata%s)",
+			internal ? "static inline " : "",
+			god, function, internal ? "dispatch" : "message", god, datatype, unpack ? "" : "*",
+			dlc ? ", uint8_t dlc, dbcc_time_stamp_t time_stamp" : "");
+}
+
+static int batch_name(writer_t *c, const char *function, bool unpack, const char *god)
+{
+	assert(c);
+	assert(function);
+	assert(god);
+	return writer_printf(c, "size_t candb_%s_%s_messages(can_%s_t *o, %sdbcc_frame_t *frames, size_t n)",
+			god, function, god, unpack ? "const " : "");
+}
+
+/* Variants of 'unpack_message' and 'pack_message' that take the payload as
+ * bytes, either an array of eight or a Linux SocketCAN 'struct can_frame' */
+static int bytes_name(writer_t *c, const char *function, bool unpack, const char *god)
+{
+	assert(c);
+	assert(function);
+	assert(god);
+	return writer_printf(c, "int candb_%s_%s_bytes(can_%s_t *o, const unsigned long id, %suint8_t data[8]%s)",
+			god, function, god, unpack ? "const " : "",
+			unpack ? ", uint8_t dlc, dbcc_time_stamp_t time_stamp" : "");
+}
+
+static int can_frame_name(writer_t *c, const char *function, bool unpack, const char *god)
+{
+	assert(c);
+	assert(function);
+	assert(god);
+	return writer_printf(c, "int candb_%s_%s_can_frame(can_%s_t *o, %sstruct can_frame *frame%s)",
+			god, function, god, unpack ? "const " : "",
+			unpack ? ", dbcc_time_stamp_t time_stamp" : "");
+}
+
+static int dispatch_prototypes(writer_t *c, const char *function, bool unpack, const char *datatype, bool dlc, const char *god)
+{
+	assert(c);
+	dispatch_name(c, function, unpack, datatype, dlc, god, false);
+	writer_puts(c, ";\n");
+	batch_name(c, function, unpack, god);
+	writer_puts(c, ";\n");
+	bytes_name(c, function, unpack, god);
+	writer_puts(c, ";\n");
+	writer_puts(c, "#if DBCC_CAN_FRAME\n");
+	can_frame_name(c, function, unpack, god);
+	return writer_puts(c, ";\n#endif\n");
+}
+
+/* The payload is loaded with one (unaligned) load, as the bytes are in
+ * the order of a little endian 'uint64_t'. The CAN ID and DLC of a 'struct
+ * can_frame' are set by the caller when packing. */
+static int frame_functions(writer_t *c, const char *function, bool unpack, const char *god, dbc2c_options_t *copts)
+{
+	assert(c);
+	assert(function);
+	assert(god);
+	assert(copts);
+	bytes_name(c, function, unpack, god);
+	writer_puts(c, " {\n");
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(data);\n");
+	if (unpack) {
+		writer_printf(c, "\treturn candb_%s_unpack_message(o, id, dbcc_load_le64(data), dlc, time_stamp);\n}\n\n", god);
+	} else {
+		writer_puts(c, "\tuint64_t x = 0;\n");
+		writer_printf(c, "\tconst int r = candb_%s_pack_message(o, id, &x);\n", god);
+		writer_puts(c, "\tif (r >= 0)\n\t\tdbcc_store_le64(data, x);\n");
+		writer_puts(c, "\treturn r;\n}\n\n");
+	}
+
+	writer_puts(c, "#if DBCC_CAN_FRAME\n");
+	can_frame_name(c, function, unpack, god);
+	writer_puts(c, " {\n");
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(frame);\n");
+	writer_puts(c, "\tif (frame->can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG))\n\t\treturn -1;\n");
+	writer_puts(c, "\tconst unsigned long id = frame->can_id & ((frame->can_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK);\n");
+	if (unpack)
+		writer_printf(c, "\treturn candb_%s_unpack_bytes(o, id, frame->data, frame->can_dlc, time_stamp);\n", god);
+	else
+		writer_printf(c, "\treturn candb_%s_pack_bytes(o, id, frame->data);\n", god);
+	return writer_puts(c, "}\n#endif\n\n");
+}
+
+static int message_functions(writer_t *c, const char *function, bool unpack, const char *datatype, bool dlc, const char *god, dbc2c_options_t *copts)
+{
+	assert(c);
+	assert(function);
+	assert(god);
+	assert(copts);
+	dispatch_name(c, function, unpack, datatype, dlc, god, false);
+	writer_puts(c, " {\n");
+	if (copts->generate_asserts) {
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(id < (1ul << 29)); /* 29-bit CAN ID is largest possible */\n");
+		if (dlc)
+			writer_puts(c, "\tassert(dlc <= 8);         /* Maximum of 8 bytes in a CAN packet */\n");
+	}
+	writer_printf(c, "\treturn candb_%s_%s_dispatch(o, id, data%s);\n}\n\n", god, function, dlc ? ", dlc, time_stamp" : "");
+
+	batch_name(c, function, unpack, god);
+	writer_puts(c, " {\n");
+	if (copts->generate_asserts) {
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(frames || !n);\n");
+	}
+	writer_puts(c, "\tsize_t done = 0;\n");
+	writer_puts(c, "\tfor (size_t i = 0; i < n; i++) {\n");
+	if (copts->generate_asserts) {
+		writer_puts(c, "\t\tassert(frames[i].id < (1ul << 29));\n");
+		if (dlc)
+			writer_puts(c, "\t\tassert(frames[i].dlc <= 8);\n");
+	}
+	if (unpack)
+		writer_printf(c, "\t\tdone += candb_%s_%s_dispatch(o, frames[i].id, frames[i].data, frames[i].dlc, frames[i].time_stamp) >= 0;\n", god, function);
+	else
+		writer_printf(c, "\t\tdone += candb_%s_%s_dispatch(o, frames[i].id, &frames[i].data) >= 0;\n", god, function);
+	writer_puts(c, "\t}\n");
+	return writer_puts(c, "\treturn done;\n}\n\n");
+}
+
+/* Dirty tracking; with '-n' an encode function that changes the value of a
+ * signal marks its message as dirty, and packing the message clears it.
+ * 'candb_<name>_pack_dirty' packs the dirty messages, in order of their IDs,
+ * into an array of frames for transmission. A message that does not fit, or
+ * cannot be packed, stays dirty for the next call. */
+static int pack_dirty_name(writer_t *c, const char *god, const char *postfix)
+{
+	assert(c);
+	assert(god);
+	assert(postfix);
+	return writer_printf(c, "size_t candb_%s_pack_dirty(can_%s_t *o, dbcc_frame_t *frames, size_t n)%s", god, god, postfix);
+}
+
+static int pack_dirty(writer_t *c, dbc_t *dbc, const char *god, dbc2c_options_t *copts)
+{
+	assert(c);
+	assert(dbc);
+	assert(god);
+	assert(copts);
+	pack_dirty_name(c, god, " {\n");
+	if (copts->generate_asserts) {
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(frames || !n);\n");
+	}
+	writer_puts(c, "\tsize_t done = 0;\n");
+	for (size_t i = 0; i < dbc->message_count; i++) {
+		const can_msg_t *msg = dbc->messages[i];
+		char name[MAX_NAME_LENGTH] = {0};
+		make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
+		writer_printf(c, "\tif (o->%s_dirty && done < n) {\n", name);
+		writer_printf(c, "\t\tframes[done].id = 0x%lx;\n", msg->id);
+		writer_puts(c, "\t\tframes[done].data = 0;\n");
+		writer_printf(c, "\t\tframes[done].dlc = %u;\n", msg->dlc);
+		writer_puts(c, "\t\tframes[done].time_stamp = 0;\n");
+		writer_printf(c, "\t\tif (pack_%s_%s(o, &frames[done].data) >= 0)\n", god, name);
+		writer_puts(c, "\t\t\tdone++;\n");
+		writer_puts(c, "\t}\n");
 	}
-	return 0;
+	writer_puts(c, "\treturn done;\n");
+	return writer_puts(c, "}\n\n");
 }
 
-static int msg2c(can_msg_t *msg, FILE *c, dbc2c_options_t *copts, char *god)
+/* Receive queue; with '-Q' an interrupt handler can push frames into a ring
+ * buffer for a task to unpack later, so the time spent in the handler does
+ * not depend on the messages. There must be one producer and one consumer.
+ * Each side only writes its own index, with a release store after the frame
+ * it covers, and the consumer moves its index once per batch. The indices
+ * run freely and wrap, which works as the length is a power of two. Only
+ * atomic loads and stores are used, not read-modify-write operations, which
+ * some micro-controllers do not have. */
+static const char *rx_queue_type =
+"#ifndef DBCC_QUEUE\n"
+"#define DBCC_QUEUE\n"
+"#ifndef DBCC_QUEUE_LENGTH /* frames the receive queue holds, a power of two */\n"
+"#define DBCC_QUEUE_LENGTH (64u)\n"
+"#endif\n"
+"#if (DBCC_QUEUE_LENGTH & (DBCC_QUEUE_LENGTH - 1u)) != 0\n"
+"#error \"DBCC_QUEUE_LENGTH must be a power of two\"\n"
+"#endif\n"
+"typedef struct {\n"
+"\tdbcc_frame_t frames[DBCC_QUEUE_LENGTH];\n"
+"\tatomic_uint head;    /* frames pushed, only written by the producer */\n"
+"\tatomic_uint tail;    /* frames drained, only written by the consumer */\n"
+"\tatomic_uint dropped; /* frames not pushed as the queue was full, only written by the producer */\n"
+"} dbcc_queue_t;\n\n"
+"static inline int dbcc_queue_push(dbcc_queue_t *q, const unsigned long id, const uint64_t data, const uint8_t dlc, const dbcc_time_stamp_t time_stamp) {\n"
+"\tconst unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);\n"
+"\tif (head - atomic_load_explicit(&q->tail, memory_order_acquire) >= DBCC_QUEUE_LENGTH) {\n"
+"\t\tatomic_store_explicit(&q->dropped, atomic_load_explicit(&q->dropped, memory_order_relaxed) + 1u, memory_order_relaxed);\n"
+"\t\treturn -1;\n"
+"\t}\n"
+"\tdbcc_frame_t *f = &q->frames[head & (DBCC_QUEUE_LENGTH - 1u)];\n"
+"\tf->id = id;\n"
+"\tf->data = data;\n"
+"\tf->dlc = dlc;\n"
+"\tf->time_stamp = time_stamp;\n"
+"\tatomic_store_explicit(&q->head, head + 1u, memory_order_release);\n"
+"\treturn 0;\n"
+"}\n"
+"#endif\n\n";
+
+/* unpack up to 'n' frames from the queue, returning the number removed from
+ * it, which includes frames with unknown IDs */
+static int rx_queue_drain(writer_t *c, const char *god, dbc2c_options_t *copts)
 {
-	assert(msg);
 	assert(c);
-	assert(copts);
 	assert(god);
-	char name[MAX_NAME_LENGTH] = {0};
-	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
-	bool motorola_used = false;
-	bool intel_used = false;
-
-	for (size_t i = 0; i < msg->signal_count; i++)
-		if (msg->sigs[i]->endianess == endianess_motorola_e)
-			motorola_used = true;
-		else
-			intel_used = true;
-
-	/* sanity checks against messages should go here, we could check for;
-	 * - odd min/max values given scaling
-	 * - duplicate signals and messages
-	 * They really should go into a semantic analysis phase after reading
-	 * in the DBC file and parsing it. Oh Well. */
-	msg_dlc_check(msg);
+	assert(copts);
+	writer_printf(c, "size_t candb_%s_drain(can_%s_t *o, dbcc_queue_t *q, size_t n) {\n", god, god);
+	if (copts->generate_asserts) {
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(q);\n");
+	}
+	writer_puts(c, "\tconst unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);\n");
+	writer_puts(c, "\tunsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);\n");
+	writer_puts(c, "\tsize_t done = 0;\n");
+	writer_puts(c, "\tfor (; tail != head && done < n; tail++, done++) {\n");
+	writer_puts(c, "\t\tconst dbcc_frame_t *f = &q->frames[tail & (DBCC_QUEUE_LENGTH - 1u)];\n");
+	writer_printf(c, "\t\t(void)candb_%s_unpack_dispatch(o, f->id, f->data, f->dlc, f->time_stamp);\n", god);
+	writer_puts(c, "\t}\n");
+	writer_puts(c, "\tatomic_store_explicit(&q->tail, tail, memory_order_release);\n");
+	writer_puts(c, "\treturn done;\n");
+	return writer_puts(c, "}\n\n");
+}
 
-	if (copts->generate_pack && msg_pack(msg, c, name, motorola_used, intel_used, god, copts) < 0)
-		return -1;
+/* Epochs; with '-E' a whole copy of the object holding all of the messages is
+ * published at once. The writer unpacks into a buffer no reader can see, and
+ * 'candb_<name>_publish' makes it the latest one and gives the writer a copy
+ * of it to carry on with, in a buffer that no reader has pinned. A reader pins
+ * the latest buffer, which is not written to until it is unpinned, so all of
+ * its messages are from the same epoch. The count of readers is rechecked
+ * against the latest buffer after being incremented, as the writer may have
+ * moved on, which needs sequentially consistent atomics. The writer never
+ * waits, but cannot publish if every other buffer is pinned, so there are at
+ * least three. */
+static int epoch_types(writer_t *h, const char *god)
+{
+	assert(h);
+	assert(god);
+	writer_puts(h, "typedef struct {\n");
+	writer_printf(h, "\tcan_%s_t buffer[DBCC_BUFFERS];\n", god);
+	writer_puts(h, "\tunsigned long epoch[DBCC_BUFFERS]; /* epoch each buffer was published in, 0 if never */\n");
+	writer_puts(h, "\tatomic_uint readers[DBCC_BUFFERS]; /* number of readers that have pinned each buffer */\n");
+	writer_puts(h, "\tatomic_uint latest;                /* buffer most recently published */\n");
+	writer_puts(h, "\tunsigned write;                    /* buffer being written, only used by the writer */\n");
+	writer_puts(h, "\tunsigned long epochs;              /* number of publishes, only used by the writer */\n");
+	writer_printf(h, "} can_%s_epochs_t;\n\n", god);
+	writer_printf(h, "void candb_%s_epochs_init(can_%s_epochs_t *b);\n", god, god);
+	writer_printf(h, "can_%s_t *candb_%s_writing(can_%s_epochs_t *b);\n", god, god, god);
+	writer_printf(h, "int candb_%s_publish(can_%s_epochs_t *b);\n", god, god);
+	writer_printf(h, "const can_%s_t *candb_%s_pin(can_%s_epochs_t *b, unsigned long *epoch);\n", god, god, god);
+	return writer_printf(h, "void candb_%s_unpin(can_%s_epochs_t *b, const can_%s_t *o);\n\n", god, god, god);
+}
 
-	if (copts->generate_unpack && msg_unpack(msg, c, name, motorola_used, intel_used, god, copts) < 0)
-		return -1;
+static int epoch_functions(writer_t *c, const char *god, dbc2c_options_t *copts)
+{
+	assert(c);
+	assert(god);
+	assert(copts);
+	writer_printf(c, "void candb_%s_epochs_init(can_%s_epochs_t *b) {\n", god, god);
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(b);\n");
+	writer_puts(c, "\tmemset(b, 0, sizeof (*b));\n");
+	writer_puts(c, "\tfor (unsigned i = 0; i < DBCC_BUFFERS; i++)\n");
+	writer_puts(c, "\t\tatomic_init(&b->readers[i], 0u);\n");
+	writer_puts(c, "\tatomic_init(&b->latest, 0u);\n");
+	writer_puts(c, "\tb->write = 1;\n");
+	writer_puts(c, "}\n\n");
+
+	writer_printf(c, "can_%s_t *candb_%s_writing(can_%s_epochs_t *b) {\n", god, god, god);
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(b);\n");
+	writer_puts(c, "\treturn &b->buffer[b->write];\n");
+	writer_puts(c, "}\n\n");
 
-	for (size_t i = 0; i < msg->signal_count; i++) {
-		if (copts->generate_unpack)
-			if (signal2scaling(name, msg->id, msg->sigs[i], c, true, false, god, copts) < 0)
-				return -1;
-		if (copts->generate_pack)
-			if (signal2scaling(name, msg->id, msg->sigs[i], c, false, false, god, copts) < 0)
-				return -1;
+	writer_printf(c, "int candb_%s_publish(can_%s_epochs_t *b) {\n", god, god);
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(b);\n");
+	writer_puts(c, "\tconst unsigned latest = atomic_load_explicit(&b->latest, memory_order_relaxed);\n");
+	writer_puts(c, "\tfor (unsigned i = 0; i < DBCC_BUFFERS; i++) {\n");
+	writer_puts(c, "\t\tif (i == b->write || i == latest || atomic_load(&b->readers[i]))\n");
+	writer_puts(c, "\t\t\tcontinue;\n");
+	writer_puts(c, "\t\tb->epoch[b->write] = ++b->epochs;\n");
+	writer_puts(c, "\t\tatomic_store(&b->latest, b->write);\n");
+	writer_puts(c, "\t\tb->buffer[i] = b->buffer[b->write];\n");
+	writer_puts(c, "\t\tb->write = i;\n");
+	writer_puts(c, "\t\treturn 0;\n");
+	writer_puts(c, "\t}\n");
+	writer_puts(c, "\treturn -1;\n");
+	writer_puts(c, "}\n\n");
+
+	writer_printf(c, "const can_%s_t *candb_%s_pin(can_%s_epochs_t *b, unsigned long *epoch) {\n", god, god, god);
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(b);\n");
+	writer_puts(c, "\tfor (;;) {\n");
+	writer_puts(c, "\t\tconst unsigned i = atomic_load(&b->latest);\n");
+	writer_puts(c, "\t\tatomic_fetch_add(&b->readers[i], 1u);\n");
+	writer_puts(c, "\t\tif (atomic_load(&b->latest) == i) {\n");
+	writer_puts(c, "\t\t\tif (epoch)\n");
+	writer_puts(c, "\t\t\t\t*epoch = b->epoch[i];\n");
+	writer_puts(c, "\t\t\treturn &b->buffer[i];\n");
+	writer_puts(c, "\t\t}\n");
+	writer_puts(c, "\t\tatomic_fetch_sub(&b->readers[i], 1u);\n");
+	writer_puts(c, "\t}\n");
+	writer_puts(c, "}\n\n");
+
+	writer_printf(c, "void candb_%s_unpin(can_%s_epochs_t *b, const can_%s_t *o) {\n", god, god, god);
+	if (copts->generate_asserts) {
+		writer_puts(c, "\tassert(b);\n");
+		writer_puts(c, "\tassert(o >= &b->buffer[0] && o < &b->buffer[DBCC_BUFFERS]);\n");
 	}
+	writer_puts(c, "\tatomic_fetch_sub(&b->readers[o - &b->buffer[0]], 1u);\n");
+	return writer_puts(c, "}\n\n");
+}
 
-	if (copts->generate_print && msg_print(msg, c, name, god, copts) < 0)
-		return -1;
-
-	return 0;
+/* FNV-1a of the parts of a DBC file, and of the options, that change the
+ * meaning or layout of the object holding all of the messages, so that
+ * processes sharing it can check they were built from the same ones */
+static uint64_t fnv1a(uint64_t h, const char *s)
+{
+	assert(s);
+	for (;; s++) {
+		h ^= (unsigned char)*s;
+		h *= UINT64_C(0x100000001b3);
+		if (!*s)
+			return h;
+	}
 }
 
-static int msg2h(can_msg_t *msg, FILE *h, dbc2c_options_t *copts, const char *god)
+static uint64_t dbc_hash(dbc_t *dbc, dbc2c_options_t *copts)
 {
-	assert(msg);
-	assert(h);
+	assert(dbc);
 	assert(copts);
-	assert(god);
-	char name[MAX_NAME_LENGTH] = {0};
-	make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
-
-	for (size_t i = 0; i < msg->signal_count; i++) {
-		if (copts->generate_unpack)
-			if (signal2scaling(name, msg->id, msg->sigs[i], h, true, true, god, copts) < 0)
-				return -1;
-		if (copts->generate_pack)
-			if (signal2scaling(name, msg->id, msg->sigs[i], h, false, true, god, copts) < 0)
-				return -1;
+	char b[256] = { 0 };
+	uint64_t h = UINT64_C(0xcbf29ce484222325);
+	snprintf(b, sizeof b, "%d %d %d %d %d", copts->use_cache_line_layout, copts->use_seqlock,
+			copts->use_change_detection, copts->use_lazy_decoding, copts->use_dirty_tracking);
+	h = fnv1a(h, b);
+	for (size_t i = 0; i < dbc->message_count; i++) {
+		const can_msg_t *msg = dbc->messages[i];
+		h = fnv1a(h, msg->name);
+		snprintf(b, sizeof b, "%lu %u %zu", msg->id, msg->dlc, msg->signal_count);
+		h = fnv1a(h, b);
+		for (size_t j = 0; j < msg->signal_count; j++) {
+			const signal_t *sig = msg->sigs[j];
+			h = fnv1a(h, sig->name);
+			snprintf(b, sizeof b, "%u %u %d %d %d %u %d %d %u %.17g %.17g",
+					sig->start_bit, sig->bit_length, (int)sig->endianess,
+					sig->is_signed, sig->is_floating, sig->sigval,
+					sig->is_multiplexor, sig->is_multiplexed, sig->switchval,
+					sig->scaling, sig->offset);
+			h = fnv1a(h, b);
+		}
 	}
-	fputs("\n\n", h);
-	return 0;
+	return h;
 }
 
-static const char *cfunctions =
-"static inline uint64_t reverse_byte_order(uint64_t x) {\n"
-"\tx = (x & 0x00000000FFFFFFFF) << 32 | (x & 0xFFFFFFFF00000000) >> 32;\n"
-"\tx = (x & 0x0000FFFF0000FFFF) << 16 | (x & 0xFFFF0000FFFF0000) >> 16;\n"
-"\tx = (x & 0x00FF00FF00FF00FF) << 8  | (x & 0xFF00FF00FF00FF00) >> 8;\n"
-"\treturn x;\n"
-"}\n\n";
-static const char *cfunctions_print_only =
-"static inline int print_helper(int r, int print_return_value) {\n"
-"\treturn ((r >= 0) && (print_return_value >= 0)) ? r + print_return_value : -1;\n"
-"}\n\n";
-
-static int message_compare_function(const void *a, const void *b)
+/* Shared memory; with '-M' the object holding all of the messages, with a
+ * sequence lock for each (as with '-l'), can be put in a POSIX shared memory
+ * object behind a header. One process creates it and unpacks into it, others
+ * attach to it read only and take snapshots of messages. Attaching fails
+ * unless the header says the object is fully set up and was made from the
+ * same DBC file and options, with the same layout. */
+static int shm_types(writer_t *h, const char *god)
 {
-	assert(a);
-	assert(b);
-	can_msg_t *ap = *((can_msg_t**)a);
-	can_msg_t *bp = *((can_msg_t**)b);
-	if (ap->id <  bp->id) return -1;
-	if (ap->id == bp->id) return  0;
-	if (ap->id >  bp->id) return  1;
-	return 0;
+	assert(h);
+	assert(god);
+	writer_puts(h, "#if DBCC_SHM\n");
+	writer_puts(h, "typedef struct {\n");
+	writer_puts(h, "\tatomic_uint magic; /* DBCC_SHM_MAGIC once the rest is set up */\n");
+	writer_puts(h, "\tuint32_t version;  /* DBCC_SHM_VERSION */\n");
+	writer_puts(h, "\tuint64_t hash;     /* of the messages, signals and options used */\n");
+	writer_puts(h, "\tuint64_t size;     /* size of 'bus' */\n");
+	writer_printf(h, "\tcan_%s_t bus;\n", god);
+	writer_printf(h, "} can_%s_shm_t;\n\n", god);
+	writer_printf(h, "can_%s_shm_t *candb_%s_shm_create(const char *name);\n", god, god);
+	writer_printf(h, "const can_%s_shm_t *candb_%s_shm_attach(const char *name); /* mapped read only */\n", god, god);
+	writer_printf(h, "int candb_%s_shm_detach(const can_%s_shm_t *shm);\n", god, god);
+	return writer_puts(h, "#endif\n\n");
 }
 
-static int signal_compare_function(const void *a, const void *b)
+static int shm_functions(writer_t *c, dbc_t *dbc, const char *god, dbc2c_options_t *copts)
 {
-	assert(a);
-	assert(b);
-	signal_t *ap = *((signal_t**)a);
-	signal_t *bp = *((signal_t**)b);
-	if (ap->bit_length <  bp->bit_length) return  1;
-	if (ap->bit_length == bp->bit_length) return  0;
-	if (ap->bit_length >  bp->bit_length) return -1;
-	return 0;
+	assert(c);
+	assert(dbc);
+	assert(god);
+	assert(copts);
+	const uint64_t hash = dbc_hash(dbc, copts);
+	writer_puts(c, "#if DBCC_SHM\n");
+	writer_printf(c, "can_%s_shm_t *candb_%s_shm_create(const char *name) {\n", god, god);
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(name);\n");
+	writer_puts(c, "\tconst int fd = shm_open(name, O_RDWR | O_CREAT, 0644);\n");
+	writer_puts(c, "\tif (fd < 0)\n\t\treturn NULL;\n");
+	writer_printf(c, "\tif (ftruncate(fd, sizeof (can_%s_shm_t)) < 0) {\n", god);
+	writer_puts(c, "\t\tclose(fd);\n\t\treturn NULL;\n\t}\n");
+	writer_printf(c, "\tvoid *m = mmap(NULL, sizeof (can_%s_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);\n", god);
+	writer_puts(c, "\tclose(fd);\n");
+	writer_puts(c, "\tif (m == MAP_FAILED)\n\t\treturn NULL;\n");
+	writer_printf(c, "\tcan_%s_shm_t *shm = m;\n", god);
+	writer_puts(c, "\tatomic_store_explicit(&shm->magic, 0u, memory_order_relaxed);\n");
+	writer_puts(c, "\tmemset(&shm->bus, 0, sizeof (shm->bus));\n");
+	for (size_t i = 0; i < dbc->message_count; i++) {
+		char name[MAX_NAME_LENGTH] = {0};
+		make_name(name, MAX_NAME_LENGTH, dbc->messages[i]->name, dbc->messages[i]->id, copts);
+		writer_printf(c, "\tatomic_init(&shm->bus.%s_seq, 0u);\n", name);
+	}
+	writer_puts(c, "\tshm->version = DBCC_SHM_VERSION;\n");
+	writer_printf(c, "\tshm->hash = UINT64_C(0x%016" PRIx64 ");\n", hash);
+	writer_puts(c, "\tshm->size = sizeof (shm->bus);\n");
+	writer_puts(c, "\tatomic_store_explicit(&shm->magic, DBCC_SHM_MAGIC, memory_order_release);\n");
+	writer_puts(c, "\treturn shm;\n");
+	writer_puts(c, "}\n\n");
+
+	writer_printf(c, "const can_%s_shm_t *candb_%s_shm_attach(const char *name) {\n", god, god);
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(name);\n");
+	writer_puts(c, "\tconst int fd = shm_open(name, O_RDONLY, 0);\n");
+	writer_puts(c, "\tif (fd < 0)\n\t\treturn NULL;\n");
+	writer_puts(c, "\tstruct stat st;\n");
+	writer_printf(c, "\tif (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof (can_%s_shm_t)) {\n", god);
+	writer_puts(c, "\t\tclose(fd);\n\t\treturn NULL;\n\t}\n");
+	writer_printf(c, "\tvoid *m = mmap(NULL, sizeof (can_%s_shm_t), PROT_READ, MAP_SHARED, fd, 0);\n", god);
+	writer_puts(c, "\tclose(fd);\n");
+	writer_puts(c, "\tif (m == MAP_FAILED)\n\t\treturn NULL;\n");
+	writer_printf(c, "\tcan_%s_shm_t *shm = m;\n", god);
+	writer_puts(c, "\tif (atomic_load_explicit(&shm->magic, memory_order_acquire) != DBCC_SHM_MAGIC\n");
+	writer_puts(c, "\t\t\t|| shm->version != DBCC_SHM_VERSION\n");
+	writer_printf(c, "\t\t\t|| shm->hash != UINT64_C(0x%016" PRIx64 ")\n", hash);
+	writer_puts(c, "\t\t\t|| shm->size != sizeof (shm->bus)) {\n");
+	writer_puts(c, "\t\tmunmap(m, sizeof (*shm));\n");
+	writer_puts(c, "\t\treturn NULL;\n");
+	writer_puts(c, "\t}\n");
+	writer_puts(c, "\treturn shm;\n");
+	writer_puts(c, "}\n\n");
+
+	writer_printf(c, "int candb_%s_shm_detach(const can_%s_shm_t *shm) {\n", god, god);
+	if (copts->generate_asserts)
+		writer_puts(c, "\tassert(shm);\n");
+	writer_puts(c, "\treturn munmap((void *)shm, sizeof (*shm));\n");
+	return writer_puts(c, "}\n#endif\n\n");
 }
 
-static int switch_function(FILE *c, dbc_t *dbc, char *function, bool unpack,
+static int switch_function(writer_t *c, dbc_t *dbc, const hot_t *hot, char *function, bool unpack,
 		bool prototype, const char *datatype, bool dlc, const char *god, dbc2c_options_t *copts)
 {
 	assert(c);
@@ -803,63 +2513,308 @@ static int switch_function(FILE *c, dbc_t *dbc, char *function, bool unpack,
 	assert(function);
 	assert(god);
 	assert(copts);
-	fprintf(c, "int candb_%s_%s_message(can_%s_t *o, const unsigned long id, %s %sdata%s)",
-			god, function, god, datatype, unpack ? "" : "*",
-			dlc ? ", uint8_t dlc, dbcc_time_stamp_t time_stamp" : "");
 	if (prototype)
-		return fprintf(c, ";\n");
-	fprintf(c, " {\n");
-	if (copts->generate_asserts) {
-		fprintf(c, "\tassert(o);\n");
-		fprintf(c, "\tassert(id < (1ul << 29)); /* 29-bit CAN ID is largest possible */\n");
-		if (dlc)
-			fprintf(c, "\tassert(dlc <= 8);         /* Maximum of 8 bytes in a CAN packet */\n");
-	}
+		return dispatch_prototypes(c, function, unpack, datatype, dlc, god);
+	dispatch_name(c, function, unpack, datatype, dlc, god, true);
+	writer_puts(c, " {\n");
+	hot_dispatch(c, hot, function, dlc, god, copts);
 
-	fprintf(c, "\tswitch (id) {\n");
+	writer_puts(c, "\tswitch (id) {\n");
 	for (size_t i = 0; i < dbc->message_count; i++) {
 		can_msg_t *msg = dbc->messages[i];
 		char name[MAX_NAME_LENGTH] = {0};
 		make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
-		fprintf(c, "\tcase 0x%03lx: return %s_%s_%s(o, data%s);\n",
-				msg->id,
+		writer_puts(c, "\tcase 0x");
+		writer_hex(c, msg->id, 3);
+		writer_printf(c, ": return %s_%s_%s(o, data%s);\n",
 				function,
 				god,
 				name,
 				dlc ? ", dlc, time_stamp" : "");
 	}
-	fprintf(c, "\tdefault: break; \n\t}\n");
-	return fprintf(c, "\treturn -1; \n}\n\n");
+	writer_puts(c, "\tdefault: break; \n\t}\n");
+	return writer_puts(c, "\treturn -1; \n}\n\n");
+}
+
+/* Table driven dispatch: messages with standard (11-bit) identifiers are
+ * looked up directly in a table indexed by identifier, extended identifiers
+ * go through a minimal perfect hash made here, so neither needs the chain of
+ * comparisons a compiler makes of a large sparse switch statement. The hash
+ * function is the same in this program and in the generated code. */
+#define MAX_STANDARD_ID (0x7FFul)
+#define MAX_PHF_SEED    (1ul << 24)
+
+static const char *phf_function =
+"static inline uint32_t dbcc_hash(uint32_t x) {\n"
+"\tx ^= x >> 16;\n"
+"\tx *= UINT32_C(0x7feb352d);\n"
+"\tx ^= x >> 15;\n"
+"\tx *= UINT32_C(0x846ca68b);\n"
+"\tx ^= x >> 16;\n"
+"\treturn x;\n"
+"}\n\n";
+
+static uint32_t phf_hash(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= UINT32_C(0x7feb352d);
+	x ^= x >> 15;
+	x *= UINT32_C(0x846ca68b);
+	x ^= x >> 16;
+	return x;
+}
+
+typedef struct {
+	size_t count;      /**< number of keys, and of slots */
+	uint32_t *seeds;   /**< seed for each bucket, there are 'count' buckets */
+	can_msg_t **slots; /**< message for each slot */
+} phf_t;
+
+static void phf_delete(phf_t *p)
+{
+	assert(p);
+	free(p->seeds);
+	free(p->slots);
+	p->seeds = NULL;
+	p->slots = NULL;
+	p->count = 0;
+}
+
+static uint32_t phf_slot(const phf_t *p, uint32_t key, uint32_t seed)
+{
+	assert(p);
+	return phf_hash(key ^ seed) % p->count;
+}
+
+/* Hash and displace; the keys are split into buckets by their hash, then
+ * starting with the largest bucket a seed is searched for that moves all of
+ * the keys in the bucket to free slots. */
+static int phf_build(phf_t *p, can_msg_t **msgs, size_t n)
+{
+	assert(p);
+	assert(msgs);
+	int r = -1;
+	p->count = n;
+	p->seeds = allocate(sizeof(*p->seeds) * (n + 1));
+	p->slots = allocate(sizeof(*p->slots) * (n + 1));
+	if (!n)
+		return 0;
+	size_t *sizes   = allocate(sizeof(*sizes) * (n + 1));
+	size_t *starts  = allocate(sizeof(*starts) * (n + 2));
+	can_msg_t **buckets = allocate(sizeof(*buckets) * n);
+	uint32_t *tried = allocate(sizeof(*tried) * n);
+	size_t largest = 0;
+
+	for (size_t i = 0; i < n; i++)
+		sizes[phf_hash(msgs[i]->id) % n]++;
+	for (size_t i = 0; i < n; i++) {
+		starts[i + 1] = starts[i] + sizes[i];
+		if (sizes[i] > largest)
+			largest = sizes[i];
+	}
+	for (size_t i = 0; i < n; i++) {
+		const size_t b = phf_hash(msgs[i]->id) % n;
+		buckets[starts[b] + --sizes[b]] = msgs[i];
+	}
+	for (size_t i = 0; i < n; i++)
+		sizes[i] = starts[i + 1] - starts[i];
+
+	for (size_t size = largest; size; size--) {
+		for (size_t b = 0; b < n; b++) {
+			if (sizes[b] != size)
+				continue;
+			can_msg_t **keys = &buckets[starts[b]];
+			uint32_t seed = 1;
+			for (; seed < MAX_PHF_SEED; seed++) {
+				size_t placed = 0;
+				for (; placed < size; placed++) {
+					const uint32_t slot = phf_slot(p, keys[placed]->id, seed);
+					if (p->slots[slot])
+						break;
+					size_t j = 0;
+					for (; j < placed && tried[j] != slot; j++)
+						;
+					if (j < placed)
+						break;
+					tried[placed] = slot;
+				}
+				if (placed == size)
+					break;
+			}
+			if (seed == MAX_PHF_SEED) {
+				warning("could not make a perfect hash of the extended message identifiers");
+				goto fail;
+			}
+			for (size_t i = 0; i < size; i++)
+				p->slots[tried[i]] = keys[i];
+			p->seeds[b] = seed;
+		}
+	}
+	r = 0;
+fail:
+	free(sizes);
+	free(starts);
+	free(buckets);
+	free(tried);
+	return r;
+}
+
+static int dispatch_tables(writer_t *c, dbc_t *dbc, phf_t *phf, const char *god)
+{
+	assert(c);
+	assert(dbc);
+	assert(phf);
+	assert(god);
+	size_t extended = 0;
+	for (size_t i = 0; i < dbc->message_count; i++) {
+		if (i && dbc->messages[i]->id == dbc->messages[i - 1]->id) {
+			warning("duplicate message identifier 0x%lx, cannot make dispatch table", dbc->messages[i]->id);
+			return -1;
+		}
+		if (dbc->messages[i]->id > MAX_STANDARD_ID)
+			extended++;
+	}
+	/* messages are sorted by identifier, so the extended ones are last */
+	if (phf_build(phf, dbc->messages + (dbc->message_count - extended), extended) < 0)
+		return -1;
+	if (!extended)
+		return 0;
+
+	writer_puts(c, phf_function);
+	writer_printf(c, "static const unsigned long candb_%s_extended_ids[%zu] = {\n", god, phf->count);
+	for (size_t i = 0; i < phf->count; i++) {
+		writer_puts(c, "\t0x");
+		writer_hex(c, phf->slots[i]->id, 3);
+		writer_puts(c, ",\n");
+	}
+	writer_puts(c, "};\n\n");
+	writer_printf(c, "static const uint32_t candb_%s_extended_seeds[%zu] = {\n", god, phf->count);
+	for (size_t i = 0; i < phf->count; i++) {
+		writer_putc(c, '\t');
+		writer_unsigned(c, phf->seeds[i]);
+		writer_puts(c, ",\n");
+	}
+	writer_puts(c, "};\n\n");
+	writer_printf(c, "static inline long candb_%s_extended_slot(const unsigned long id) {\n", god);
+	writer_puts(c, "\tconst uint32_t key = id;\n");
+	writer_printf(c, "\tconst uint32_t slot = dbcc_hash(key ^ candb_%s_extended_seeds[dbcc_hash(key) %% %zu]) %% %zu;\n",
+			god, phf->count, phf->count);
+	writer_printf(c, "\treturn candb_%s_extended_ids[slot] == id ? (long)slot : -1;\n", god);
+	return writer_puts(c, "}\n\n");
+}
+
+static int table_function(writer_t *c, dbc_t *dbc, const phf_t *phf, const hot_t *hot, char *function, bool unpack,
+		const char *datatype, bool dlc, const char *god, dbc2c_options_t *copts)
+{
+	assert(c);
+	assert(dbc);
+	assert(phf);
+	assert(function);
+	assert(god);
+	assert(copts);
+	const char *arguments = dlc ? ", dlc, time_stamp" : "";
+	unsigned long largest = 0;
+	size_t standard = 0;
+	for (size_t i = 0; i < dbc->message_count; i++)
+		if (dbc->messages[i]->id <= MAX_STANDARD_ID) {
+			largest = dbc->messages[i]->id;
+			standard++;
+		}
+
+	writer_printf(c, "typedef int (*candb_%s_%s_fn)(can_%s_t *o, %s %sdata%s);\n\n",
+			god, function, god, datatype, unpack ? "" : "*",
+			dlc ? ", uint8_t dlc, dbcc_time_stamp_t time_stamp" : "");
+	if (standard) {
+		writer_printf(c, "static const candb_%s_%s_fn candb_%s_%s_standard[0x", god, function, god, function);
+		writer_hex(c, largest, 3);
+		writer_puts(c, " + 1] = {\n");
+		for (size_t i = 0; i < standard; i++) {
+			can_msg_t *msg = dbc->messages[i];
+			char name[MAX_NAME_LENGTH] = {0};
+			make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
+			writer_puts(c, "\t[0x");
+			writer_hex(c, msg->id, 3);
+			writer_printf(c, "] = %s_%s_%s,\n", function, god, name);
+		}
+		writer_puts(c, "};\n\n");
+	}
+	if (phf->count) {
+		writer_printf(c, "static const candb_%s_%s_fn candb_%s_%s_extended[%zu] = {\n", god, function, god, function, phf->count);
+		for (size_t i = 0; i < phf->count; i++) {
+			char name[MAX_NAME_LENGTH] = {0};
+			make_name(name, MAX_NAME_LENGTH, phf->slots[i]->name, phf->slots[i]->id, copts);
+			writer_printf(c, "\t%s_%s_%s,\n", function, god, name);
+		}
+		writer_puts(c, "};\n\n");
+	}
+
+	dispatch_name(c, function, unpack, datatype, dlc, god, true);
+	writer_puts(c, " {\n");
+	hot_dispatch(c, hot, function, dlc, god, copts);
+	if (standard) {
+		writer_puts(c, "\tif (id <= 0x");
+		writer_hex(c, largest, 3);
+		writer_puts(c, ") {\n");
+		writer_printf(c, "\t\tconst candb_%s_%s_fn f = candb_%s_%s_standard[id];\n", god, function, god, function);
+		writer_printf(c, "\t\treturn f ? f(o, data%s) : -1;\n", arguments);
+		writer_puts(c, "\t}\n");
+	}
+	if (phf->count) {
+		writer_printf(c, "\tconst long slot = candb_%s_extended_slot(id);\n", god);
+		writer_printf(c, "\treturn slot < 0 ? -1 : candb_%s_%s_extended[slot](o, data%s);\n", god, function, arguments);
+	} else {
+		if (!standard)
+			writer_puts(c, "\tUNUSED(o);\n\tUNUSED(id);\n\tUNUSED(data);\n");
+		if (!standard && dlc)
+			writer_puts(c, "\tUNUSED(dlc);\n\tUNUSED(time_stamp);\n");
+		writer_puts(c, "\treturn -1;\n");
+	}
+	return writer_puts(c, "}\n\n");
 }
 
-static int switch_function_print(FILE *c, dbc_t *dbc, bool prototype, const char *god, dbc2c_options_t *copts)
+static int switch_function_print(writer_t *c, dbc_t *dbc, bool prototype, const char *god, dbc2c_options_t *copts)
 {
 	assert(c);
 	assert(dbc);
 	assert(god);
 	assert(copts);
-	fprintf(c, "int print_message(const can_%s_t *o, const unsigned long id, FILE *output)", god);
+	writer_printf(c, "int print_message(const can_%s_t *o, const unsigned long id, FILE *output)", god);
 	if (prototype)
-		return fprintf(c, ";\n");
-	fprintf(c, " {\n");
+		return writer_puts(c, ";\n");
+	writer_puts(c, " {\n");
 	if (copts->generate_asserts) {
-		fprintf(c, "\tassert(o);\n");
-		fprintf(c, "\tassert(id < (1ul << 29)); /* 29-bit CAN ID is largest possible */\n");
-		fprintf(c, "\tassert(output);\n");
+		writer_puts(c, "\tassert(o);\n");
+		writer_puts(c, "\tassert(id < (1ul << 29)); /* 29-bit CAN ID is largest possible */\n");
+		writer_puts(c, "\tassert(output);\n");
 	}
 
-	fprintf(c, "\tswitch (id) {\n");
+	writer_puts(c, "\tswitch (id) {\n");
 	for (size_t i = 0; i < dbc->message_count; i++) {
 		can_msg_t *msg = dbc->messages[i];
 		char name[MAX_NAME_LENGTH] = {0};
 		make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
-		fprintf(c, "\tcase 0x%03lx: return print_%s(o, output);\n", msg->id, name);
+		writer_printf(c, "\tcase 0x%03lx: return print_%s(o, output);\n", msg->id, name);
 	}
-	fprintf(c, "\tdefault: break; \n\t}\n");
-	return fprintf(c, "\treturn -1; \n}\n\n");
+	writer_puts(c, "\tdefault: break; \n\t}\n");
+	return writer_puts(c, "\treturn -1; \n}\n\n");
+}
+
+/* name a bit of the '_changed' field for each signal of a message */
+static int msg_change_bits(can_msg_t *msg, writer_t *h, const char *name, dbc2c_options_t *copts)
+{
+	assert(msg);
+	assert(h);
+	assert(name);
+	assert(copts);
+	if (!copts->use_change_detection || !msg->signal_count)
+		return 0;
+	writer_printf(h, "/* bits of '%s_changed', signals after the 63rd all share bit 63 */\n", name);
+	for (size_t i = 0; i < msg->signal_count; i++)
+		writer_printf(h, "#define %s_CHANGED_%s (UINT64_C(1) << %u)\n", name, msg->sigs[i]->name, change_bit(i));
+	return writer_putc(h, '\n');
 }
 
-static int msg2h_types(dbc_t *dbc, FILE *h, dbc2c_options_t *copts)
+static int msg2h_types(dbc_t *dbc, writer_t *h, dbc2c_options_t *copts)
 {
 	assert(h);
 	assert(dbc);
@@ -871,18 +2826,40 @@ static int msg2h_types(dbc_t *dbc, FILE *h, dbc2c_options_t *copts)
 		make_name(name, MAX_NAME_LENGTH, msg->name, msg->id, copts);
 
 		if (msg->comment)
-			fprintf(h, "/* %s */\n", msg->comment);
+			writer_printf(h, "/* %s */\n", msg->comment);
 
-		fprintf(h, "typedef PREPACK struct {\n" );
+		writer_printf(h, "typedef PREPACK struct {\n" );
 		for (size_t i = 0; i < msg->signal_count; i++)
 			if (signal2type(msg->sigs[i], h) < 0)
 				return -1;
-		fprintf(h, "} POSTPACK %s_t;\n\n", name);
+		writer_printf(h, "} POSTPACK %s_t;\n\n", name);
+		if (msg_change_bits(msg, h, name, copts) < 0)
+			return -1;
+
+		if (!copts->generate_physical)
+			continue;
+		writer_puts(h, "typedef struct {\n");
+		for (size_t i = 0; i < msg->signal_count; i++) {
+			signal_t *sig = msg->sigs[i];
+			writer_printf(h, "\t%s %s;", signal_physical_type(sig, copts), sig->name);
+			if (sig->units[0])
+				writer_printf(h, " /* %s */", sig->units);
+			writer_putc(h, '\n');
+		}
+		writer_printf(h, "} %s_physical_t;\n\n", name);
 	}
 	return 0;
 }
 
-static char *msg2h_god_object(dbc_t *dbc, FILE *h, const char *name, dbc2c_options_t *copts)
+/* By default the time stamps of all of the messages come first, then their
+ * status bits and then their data. With '-L' the data, time stamp and status
+ * of each message are put together, starting on a new cache line, so that
+ * unpacking a message touches as few cache lines as possible and threads
+ * handling different messages do not write to the same cache line. The
+ * object is not packed then, only the message structures are if PREPACK and
+ * POSTPACK are defined. Nor is it with '-l', as atomic types must not be
+ * packed. */
+static char *msg2h_god_object(dbc_t *dbc, writer_t *h, const char *name, dbc2c_options_t *copts)
 {
 	assert(h);
 	assert(dbc);
@@ -891,26 +2868,50 @@ static char *msg2h_god_object(dbc_t *dbc, FILE *h, const char *name, dbc2c_optio
 	const size_t object_name_len = strlen(object_name);
 	for (size_t i = 0; i < object_name_len; i++)
 		object_name[i] = (isalnum(object_name[i])) ?  tolower(object_name[i]) : '_';
-	fprintf(h, "typedef PREPACK struct {\n");
+	if (copts->use_cache_line_layout) {
+		writer_puts(h, "typedef struct {\n");
+		for (size_t i = 0; i < dbc->message_count; i++) {
+			if (msg_data_type(h, dbc->messages[i], false, copts) < 0)
+				goto fail;
+			if (msg_data_type_time_stamp(h, dbc->messages[i], copts) < 0)
+				goto fail;
+			if (msg_data_type_changes(h, dbc->messages[i], copts) < 0)
+				goto fail;
+			if (msg_data_type_seqlock(h, dbc->messages[i], copts) < 0)
+				goto fail;
+			if (msg_data_type_bitfields(h, dbc->messages[i], copts) < 0)
+				goto fail;
+		}
+		writer_printf(h, "} can_%s_t;\n\n", object_name);
+		return object_name;
+	}
+	const bool packed = !copts->use_seqlock;
+	writer_printf(h, "typedef %sstruct {\n", packed ? "PREPACK " : "");
 	for (size_t i = 0; i < dbc->message_count; i++)
 		if (msg_data_type_time_stamp(h, dbc->messages[i], copts) < 0)
 			goto fail;
+	for (size_t i = 0; i < dbc->message_count; i++)
+		if (msg_data_type_changes(h, dbc->messages[i], copts) < 0)
+			goto fail;
+	for (size_t i = 0; i < dbc->message_count; i++)
+		if (msg_data_type_seqlock(h, dbc->messages[i], copts) < 0)
+			goto fail;
 	for (size_t i = 0; i < dbc->message_count; i++)
 		if (msg_data_type_bitfields(h, dbc->messages[i], copts) < 0)
 			goto fail;
 	for (size_t i = 0; i < dbc->message_count; i++)
 		if (msg_data_type(h, dbc->messages[i], false, copts) < 0)
 			goto fail;
-	fprintf(h, "} POSTPACK can_%s_t;\n\n", object_name);
+	writer_printf(h, "} %scan_%s_t;\n\n", packed ? "POSTPACK " : "", object_name);
 	return object_name;
 fail:
 	free(object_name);
 	return NULL;
 }
 
-int dbc2c(dbc_t *dbc, FILE *c, FILE *h, const char *name, dbc2c_options_t *copts)
+int dbc2c(dbc_t *model, writer_t *c, writer_t *h, const char *name, dbc2c_options_t *copts)
 {
-	assert(dbc);
+	assert(model);
 	assert(c);
 	assert(h);
 	assert(name);
@@ -929,25 +2930,23 @@ int dbc2c(dbc_t *dbc, FILE *c, FILE *h, const char *name, dbc2c_options_t *copts
 	for (size_t i = 0; i < file_guard_len; i++)
 		file_guard[i] = (isalnum(file_guard[i])) ?  toupper(file_guard[i]) : '_';
 
-	/* sort signals by id */
-	qsort(dbc->messages, dbc->message_count, sizeof(dbc->messages[0]), message_compare_function);
-
-	/* sort by size for better struct packing */
-	for (size_t i = 0; i < dbc->message_count; i++) {
-		can_msg_t *msg = dbc->messages[i];
-		qsort(msg->sigs, msg->signal_count, sizeof(msg->sigs[0]), signal_compare_function);
-	}
+	/* sort messages by id, and signals by size for better struct packing */
+	dbc_t *dbc = dbc_sorted_copy(model);
+	phf_t phf = { .count = 0, .seeds = NULL, .slots = NULL };
+	hot_t hot = { .count = 0 };
+	hot_messages(dbc, &hot, copts);
 
 	/* header file (begin) */
-	fprintf(h, "/** CAN message encoder/decoder: automatically generated - do not edit\n");
+	writer_puts(h, "/** CAN message encoder/decoder: automatically generated - do not edit\n");
 	if (copts->use_time_stamps)
-		fprintf(h, "  * @note  Generated on %s", asctime(timeinfo));
+		writer_printf(h, "  * @note  Generated on %s", asctime(timeinfo));
 
-	fprintf(h,
+	writer_printf(h,
 		"  * Generated by dbcc: See https://github.com/howerj/dbcc */\n"
 		"#ifndef %s\n"
 		"#define %s\n\n"
 		"#include <stdint.h>\n"
+		"#include <stddef.h>\n"
 		"%s\n\n"
 		"#ifdef __cplusplus\n"
 		"extern \"C\" { \n"
@@ -956,27 +2955,120 @@ int dbc2c(dbc_t *dbc, FILE *c, FILE *h, const char *name, dbc2c_options_t *copts
 		file_guard,
 		copts->generate_print   ? "#include <stdio.h>"  : "");
 
-	fprintf(h, "#ifndef PREPACK\n");
-	fprintf(h, "#define PREPACK\n");
-	fprintf(h, "#endif\n\n");
+	if (copts->generate_inline) {
+		if (copts->use_runtime)
+			writer_puts(h, "#include \"dbcc_runtime.h\"\n");
+		if (dbc->use_float)
+			writer_puts(h, "#include <float.h>\n#include <math.h>\n");
+		if (dbc->use_float || copts->generate_unpack || copts->generate_pack)
+			writer_puts(h, "#include <string.h>\n");
+		if (copts->generate_asserts)
+			writer_puts(h, "#include <assert.h>\n");
+		writer_puts(h, "\n");
+	}
+
+	writer_puts(h, "#ifndef PREPACK\n");
+	writer_puts(h, "#define PREPACK\n");
+	writer_puts(h, "#endif\n\n");
+
+	writer_puts(h, "#ifndef POSTPACK\n");
+	writer_puts(h, "#define POSTPACK\n");
+	writer_puts(h, "#endif\n\n");
+
+	if (copts->use_cache_line_layout) {
+		writer_puts(h, "#ifndef DBCC_CACHE_LINE\n");
+		writer_puts(h, "#define DBCC_CACHE_LINE (64)\n");
+		writer_puts(h, "#endif\n\n");
+		writer_puts(h, "#ifndef DBCC_CACHE_ALIGN\n");
+		writer_puts(h, "#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)\n");
+		writer_puts(h, "#define DBCC_CACHE_ALIGN _Alignas(DBCC_CACHE_LINE)\n");
+		writer_puts(h, "#elif defined(__cplusplus) && (__cplusplus >= 201103L)\n");
+		writer_puts(h, "#define DBCC_CACHE_ALIGN alignas(DBCC_CACHE_LINE)\n");
+		writer_puts(h, "#elif defined(__GNUC__)\n");
+		writer_puts(h, "#define DBCC_CACHE_ALIGN __attribute__((aligned(DBCC_CACHE_LINE)))\n");
+		writer_puts(h, "#elif defined(_MSC_VER)\n");
+		writer_puts(h, "#define DBCC_CACHE_ALIGN __declspec(align(64))\n");
+		writer_puts(h, "#else\n");
+		writer_puts(h, "#define DBCC_CACHE_ALIGN\n");
+		writer_puts(h, "#endif\n");
+		writer_puts(h, "#endif\n\n");
+	}
+
+	writer_puts(h, "#ifndef DBCC_TIME_STAMP\n");
+	writer_puts(h, "#define DBCC_TIME_STAMP\n");
+	writer_puts(h, "typedef uint32_t dbcc_time_stamp_t; /* Time stamp for message; you decide on units */\n");
+	writer_puts(h, "#endif\n\n");
+
+	if (copts->generate_unpack || copts->generate_pack) {
+		writer_puts(h, "#ifndef DBCC_FRAME\n");
+		writer_puts(h, "#define DBCC_FRAME\n");
+		writer_puts(h, "typedef struct {\n");
+		writer_puts(h, "\tunsigned long id;             /* CAN ID */\n");
+		writer_puts(h, "\tuint64_t data;                /* payload, first byte in the least significant byte */\n");
+		writer_puts(h, "\tuint8_t dlc;                  /* Data Length Code */\n");
+		writer_puts(h, "\tdbcc_time_stamp_t time_stamp; /* time stamp of frame, not used when packing */\n");
+		writer_puts(h, "} dbcc_frame_t;\n");
+		writer_puts(h, "#endif\n\n");
+
+		writer_puts(h, "#ifndef DBCC_CAN_FRAME /* use 'struct can_frame' from Linux SocketCAN? */\n");
+		writer_puts(h, "#ifdef __linux__\n");
+		writer_puts(h, "#define DBCC_CAN_FRAME (1)\n");
+		writer_puts(h, "#else\n");
+		writer_puts(h, "#define DBCC_CAN_FRAME (0)\n");
+		writer_puts(h, "#endif\n");
+		writer_puts(h, "#endif\n\n");
+		writer_puts(h, "#if DBCC_CAN_FRAME\n");
+		writer_puts(h, "#include <linux/can.h>\n");
+		writer_puts(h, "#endif\n\n");
+	}
+
+	const bool rx_queue = copts->use_rx_queue && copts->generate_unpack;
+	if (copts->use_seqlock || copts->use_epochs || rx_queue)
+		writer_puts(h, "#include <stdatomic.h>\n\n");
+
+	if (copts->use_seqlock) {
+		writer_puts(h, "#ifndef DBCC_SEQLOCK\n");
+		writer_puts(h, "#define DBCC_SEQLOCK\n");
+		writer_puts(h, "typedef atomic_uint dbcc_seq_t; /* sequence number, odd while a message is being written */\n");
+		writer_puts(h, "#endif\n\n");
+	}
+
+	if (copts->use_shared_memory) {
+		writer_puts(h, "#ifndef DBCC_SHM /* put the messages in POSIX shared memory? */\n");
+		writer_puts(h, "#if defined(__unix__) || defined(__APPLE__)\n");
+		writer_puts(h, "#define DBCC_SHM (1)\n");
+		writer_puts(h, "#else\n");
+		writer_puts(h, "#define DBCC_SHM (0)\n");
+		writer_puts(h, "#endif\n");
+		writer_puts(h, "#endif\n\n");
+		writer_puts(h, "#ifndef DBCC_SHM_MAGIC\n");
+		writer_puts(h, "#define DBCC_SHM_MAGIC   (0x44424343u) /* \"DBCC\" */\n");
+		writer_puts(h, "#define DBCC_SHM_VERSION (1u)\n");
+		writer_puts(h, "#endif\n\n");
+	}
 
-	fprintf(h, "#ifndef POSTPACK\n");
-	fprintf(h, "#define POSTPACK\n");
-	fprintf(h, "#endif\n\n");
+	if (copts->use_epochs) {
+		writer_puts(h, "#ifndef DBCC_BUFFERS /* copies of the messages for '_publish' and '_pin' */\n");
+		writer_puts(h, "#define DBCC_BUFFERS (3)\n");
+		writer_puts(h, "#endif\n");
+		writer_puts(h, "#if DBCC_BUFFERS < 3\n");
+		writer_puts(h, "#error \"DBCC_BUFFERS must be at least three\"\n");
+		writer_puts(h, "#endif\n\n");
+	}
 
-	fprintf(h, "#ifndef DBCC_TIME_STAMP\n");
-	fprintf(h, "#define DBCC_TIME_STAMP\n");
-	fprintf(h, "typedef uint32_t dbcc_time_stamp_t; /* Time stamp for message; you decide on units */\n");
-	fprintf(h, "#endif\n\n");
+	if (rx_queue && writer_puts(h, rx_queue_type) < 0) {
+		rv = -1;
+		goto fail;
+	}
 
-	fprintf(h, "#ifndef DBCC_STATUS_ENUM\n");
-	fprintf(h, "#define DBCC_STATUS_ENUM\n");
-	fprintf(h, "typedef enum {\n");
-	fprintf(h, "\tDBCC_SIG_STAT_UNINITIALIZED_E = 0, /* Message never sent/received */\n");
-	fprintf(h, "\tDBCC_SIG_STAT_OK_E            = 1, /* Message ok */\n");
-	fprintf(h, "\tDBCC_SIG_STAT_ERROR_E         = 2, /* Encode/Decode/Timestamp/Any error */\n");
-	fprintf(h, "} dbcc_signal_status_e;\n");
-	fprintf(h, "#endif\n\n");
+	writer_puts(h, "#ifndef DBCC_STATUS_ENUM\n");
+	writer_puts(h, "#define DBCC_STATUS_ENUM\n");
+	writer_puts(h, "typedef enum {\n");
+	writer_puts(h, "\tDBCC_SIG_STAT_UNINITIALIZED_E = 0, /* Message never sent/received */\n");
+	writer_puts(h, "\tDBCC_SIG_STAT_OK_E            = 1, /* Message ok */\n");
+	writer_puts(h, "\tDBCC_SIG_STAT_ERROR_E         = 2, /* Encode/Decode/Timestamp/Any error */\n");
+	writer_puts(h, "} dbcc_signal_status_e;\n");
+	writer_puts(h, "#endif\n\n");
 
 	if (msg2h_types(dbc, h, copts) < 0) {
 		rv = -1;
@@ -989,64 +3081,130 @@ int dbc2c(dbc_t *dbc, FILE *c, FILE *h, const char *name, dbc2c_options_t *copts
 		goto fail;
 	}
 
+	if (copts->use_epochs)
+		epoch_types(h, god);
+
+	if (rx_queue)
+		writer_printf(h, "size_t candb_%s_drain(can_%s_t *o, dbcc_queue_t *q, size_t n);\n\n", god, god);
+
+	if (copts->use_dirty_tracking && copts->generate_pack)
+		pack_dirty_name(h, god, ";\n\n");
+
+	if (copts->use_shared_memory)
+		shm_types(h, god);
+
 	if (copts->generate_unpack)
-		switch_function(h, dbc, "unpack", true, true, "uint64_t", true, god, copts);
+		switch_function(h, dbc, &hot, "unpack", true, true, "uint64_t", true, god, copts);
 
 	if (copts->generate_pack)
-		switch_function(h, dbc, "pack", false, true, "uint64_t", false, god, copts);
+		switch_function(h, dbc, &hot, "pack", false, true, "uint64_t", false, god, copts);
 
 	if (copts->generate_print)
 		switch_function_print(h, dbc, true, god, copts);
 
-	fputs("\n", h);
+	writer_puts(h, "\n");
+
+	if (copts->generate_inline) {
+		writer_puts(h, "#ifndef UNUSED\n#define UNUSED(X) ((void)(X))\n#endif\n\n");
+		if (!copts->use_runtime)
+			helpers(h, dbc, copts, true);
+	}
 
 	for (size_t i = 0; i < dbc->message_count; i++)
-		if (msg2h(dbc->messages[i], h, copts, god) < 0)
-			return -1;
+		if (msg2h(dbc->messages[i], h, copts, god) < 0) {
+			rv = -1;
+			goto fail;
+		}
 
-	fputs(
+	writer_puts(h,
 		"#ifdef __cplusplus\n"
 		"} \n"
 		"#endif\n\n"
-		"#endif\n",
-		h);
+		"#endif\n");
 	/* header file (end) */
 
 	/* C FILE */
-	fputs("/* Generated by DBCC, see <https://github.com/howerj/dbcc> */\n", c);
-	fprintf(c, "#include \"%s\"\n", name);
-	fprintf(c, "#include <inttypes.h>\n");
-	if (dbc->use_float)
-		fprintf(c, "#include <math.h> /* uses macros NAN, INFINITY, signbit, no need for -lm */\n");
+	writer_puts(c, "/* Generated by DBCC, see <https://github.com/howerj/dbcc> */\n");
+	if (copts->use_shared_memory)
+		writer_puts(c, "#ifndef _POSIX_C_SOURCE\n#define _POSIX_C_SOURCE 200809L /* for 'shm_open' */\n#endif\n");
+	writer_printf(c, "#include \"%s\"\n", name);
+	writer_puts(c, "#include <inttypes.h>\n");
+	if (dbc->use_float) {
+		writer_puts(c, "#include <float.h>\n");
+		writer_puts(c, "#include <math.h> /* uses macros NAN, INFINITY, signbit, no need for -lm */\n");
+	}
+	if (dbc->use_float || copts->generate_unpack || copts->generate_pack || copts->use_epochs || copts->use_shared_memory)
+		writer_puts(c, "#include <string.h>\n");
+	if (copts->use_shared_memory) {
+		writer_puts(c, "#if DBCC_SHM\n");
+		writer_puts(c, "#include <fcntl.h>\n");
+		writer_puts(c, "#include <sys/mman.h>\n");
+		writer_puts(c, "#include <sys/stat.h>\n");
+		writer_puts(c, "#include <unistd.h>\n");
+		writer_puts(c, "#endif\n");
+	}
 	if (copts->generate_asserts)
-		fprintf(c, "#include <assert.h>\n");
-	fputc('\n', c);
-	fprintf(c, "#define UNUSED(X) ((void)(X))\n\n");
-	fputs(cfunctions, c);
-	if (copts->generate_print)
-		fputs(cfunctions_print_only, c);
-
-	if (copts->generate_unpack && dbc->use_float)
-		fputs(float_unpack, c);
-	if (copts->generate_pack && dbc->use_float)
-		fputs(float_pack, c);
+		writer_puts(c, "#include <assert.h>\n");
+	writer_putc(c, '\n');
+	writer_puts(c, "#define UNUSED(X) ((void)(X))\n\n");
+	if (copts->use_runtime) {
+		writer_puts(c, "#include \"dbcc_runtime.h\"\n\n");
+	} else {
+		if (!copts->generate_inline)
+			helpers(c, dbc, copts, false);
+		if (copts->generate_print)
+			writer_puts(c, cfunctions_print_only);
+	}
 
 	for (size_t i = 0; i < dbc->message_count; i++)
-		if (msg2c(dbc->messages[i], c, copts, god) < 0) {
+		if (msg2c(dbc->messages[i], c, copts, god, is_hot(&hot, dbc->messages[i])) < 0) {
 			rv = -1;
 			goto fail;
 		}
 
-	if (copts->generate_unpack)
-		switch_function(c, dbc, "unpack", true, false, "uint64_t", true, god, copts);
+	if (copts->use_dispatch_table) {
+		if (dispatch_tables(c, dbc, &phf, god) < 0) {
+			rv = -1;
+			goto fail;
+		}
+		if (copts->generate_unpack)
+			table_function(c, dbc, &phf, &hot, "unpack", true, "uint64_t", true, god, copts);
+		if (copts->generate_pack)
+			table_function(c, dbc, &phf, &hot, "pack", false, "uint64_t", false, god, copts);
+	} else {
+		if (copts->generate_unpack)
+			switch_function(c, dbc, &hot, "unpack", true, false, "uint64_t", true, god, copts);
+		if (copts->generate_pack)
+			switch_function(c, dbc, &hot, "pack", false, false, "uint64_t", false, god, copts);
+	}
 
-	if (copts->generate_pack)
-		switch_function(c, dbc, "pack", false, false, "uint64_t", false, god, copts);
+	if (copts->generate_unpack) {
+		message_functions(c, "unpack", true, "uint64_t", true, god, copts);
+		frame_functions(c, "unpack", true, god, copts);
+	}
+	if (copts->generate_pack) {
+		message_functions(c, "pack", false, "uint64_t", false, god, copts);
+		frame_functions(c, "pack", false, god, copts);
+	}
+
+	if (copts->use_epochs)
+		epoch_functions(c, god, copts);
+
+	if (rx_queue)
+		rx_queue_drain(c, god, copts);
+
+	if (copts->use_dirty_tracking && copts->generate_pack)
+		pack_dirty(c, dbc, god, copts);
+
+	if (copts->use_shared_memory)
+		shm_functions(c, dbc, god, copts);
 
 	if (copts->generate_print)
 		switch_function_print(c, dbc, false, god, copts);
 
 fail:
+	phf_delete(&phf);
+	dbc_sorted_delete(dbc);
 	free(file_guard);
 	free(god);
 	return rv;
@@ -6,17 +6,41 @@ extern "C" {
 #endif
 
 #include "can.h"
+#include "writer.h"
 #include <stdbool.h>
 
+typedef struct {
+	unsigned long id;    /**< CAN identifier */
+	unsigned long count; /**< number of frames seen with that identifier */
+} frame_count_t;
+
 typedef struct {
 	bool use_id_in_name;
 	bool use_time_stamps;
 	bool use_doubles_for_encoding;
+	bool use_floats_for_encoding; /**< decode scaled signals to 'float' instead of 'double' */
 	bool generate_print, generate_pack, generate_unpack;
 	bool generate_asserts;
+	bool use_dispatch_table; /**< look up messages in tables instead of a switch */
+	bool generate_extract;   /**< generate per signal column extraction functions */
+	bool generate_physical;  /**< generate pack/unpack to structures of decoded values */
+	bool use_fixed_point;    /**< decode scaled signals to integers where possible */
+	bool generate_inline;    /**< define pack, unpack, encode and decode inline in the header */
+	bool use_runtime;        /**< use the helpers in 'dbcc_runtime.h' instead of static copies */
+	bool use_cache_line_layout; /**< keep the state of each message together on its own cache line */
+	bool use_seqlock;        /**< protect each message with a sequence lock, needs C11 atomics */
+	bool use_epochs;         /**< buffer the state of all messages so readers can pin a published copy */
+	bool use_shared_memory;  /**< put the state of all messages in POSIX shared memory, implies 'use_seqlock' */
+	bool use_change_detection; /**< skip unpacking unchanged payloads and record which signals changed */
+	bool use_lazy_decoding;  /**< store each message as its payload and extract signals when decoded */
+	bool use_rx_queue;       /**< generate a queue for interrupt handlers to push frames into */
+	bool use_dirty_tracking; /**< mark messages with changed signals so only those are packed */
+	frame_count_t *profile;  /**< frame frequency profile, may be NULL */
+	size_t profile_count;    /**< number of entries in profile */
 } dbc2c_options_t;
 
-int dbc2c(dbc_t *dbc, FILE *c, FILE *h, const char *name, dbc2c_options_t *copts);
+int dbc2c(dbc_t *dbc, writer_t *c, writer_t *h, const char *name, dbc2c_options_t *copts);
+int dbc2c_runtime(writer_t *h);
 
 #ifdef __cplusplus
 }
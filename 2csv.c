@@ -9,7 +9,29 @@
 #include "util.h"
 #include <assert.h>
 
-static int msg2csv(can_msg_t *msg, FILE *o)
+static int field(writer_t *o, const char *s)
+{
+	assert(o);
+	assert(s);
+	writer_puts(o, s);
+	return writer_write(o, ", ", 2);
+}
+
+static int field_unsigned(writer_t *o, uint64_t u)
+{
+	assert(o);
+	writer_unsigned(o, u);
+	return writer_write(o, ", ", 2);
+}
+
+static int field_double(writer_t *o, double d)
+{
+	assert(o);
+	writer_double(o, d);
+	return writer_write(o, ", ", 2);
+}
+
+static int msg2csv(can_msg_t *msg, writer_t *o)
 {
 	assert(msg);
 	assert(o);
@@ -32,16 +54,18 @@ static int msg2csv(can_msg_t *msg, FILE *o)
 		}
 
 		/* "MSG, ID, DLC, Signal, Start, Length, Endianess, Scaling, Offset, Minimum, Maximum, Signed, Units, Multiplexed */
-		fprintf(o, "%s, %lu, %u, ", msg->name, msg->id, msg->dlc);
-		fprintf(o, "%s, ", sig->name);
-		fprintf(o, "%u, ", sig->start_bit);
-		fprintf(o, "%u, ", sig->bit_length);
-		fprintf(o, "%s, ", sig->endianess == endianess_motorola_e ? "motorola" : "intel");
-		fprintf(o, "%g, ", sig->scaling);
-		fprintf(o, "%g, ", sig->offset);
-		fprintf(o, "%g, ", sig->minimum);
-		fprintf(o, "%g, ", sig->maximum);
-		fprintf(o, "%s, ", sig->is_signed ? "true" : "false");
+		field(o, msg->name);
+		field_unsigned(o, msg->id);
+		field_unsigned(o, msg->dlc);
+		field(o, sig->name);
+		field_unsigned(o, sig->start_bit);
+		field_unsigned(o, sig->bit_length);
+		field(o, sig->endianess == endianess_motorola_e ? "motorola" : "intel");
+		field_double(o, sig->scaling);
+		field_double(o, sig->offset);
+		field_double(o, sig->minimum);
+		field_double(o, sig->maximum);
+		field(o, sig->is_signed ? "true" : "false");
 		bool have_units = false;
 		const char *units = sig->units;
 		for(size_t i = 0; units[i]; i++)
@@ -49,8 +73,8 @@ static int msg2csv(can_msg_t *msg, FILE *o)
 				have_units = true;
 		if(!have_units)
 			units = "none";
-		fprintf(o, "%s, ", units);
-		fprintf(o, "%s, ", multi);
+		field(o, units);
+		field(o, multi);
 
 		const char *floating = "no";
 		if (sig->is_floating) {
@@ -58,18 +82,19 @@ static int msg2csv(can_msg_t *msg, FILE *o)
 			floating = (sig->sigval == 1) ? "single" : "double";
 		}
 
-		fprintf(o, "%s, ", floating);
-		fprintf(o, "\n");
+		field(o, floating);
+		if (writer_putc(o, '\n') < 0)
+			return -1;
 	}
 
 	return 0;
 }
 
-int dbc2csv(dbc_t *dbc, FILE *output)
+int dbc2csv(dbc_t *dbc, writer_t *output)
 {
 	assert(dbc);
 	assert(output);
-	fprintf(output, "MSG, ID, DLC, Signal, Start, Length, Endianess, Scaling, Offset, Minimum, Maximum, Signed, Units, Multiplexed, Floating,\n");
+	writer_puts(output, "MSG, ID, DLC, Signal, Start, Length, Endianess, Scaling, Offset, Minimum, Maximum, Signed, Units, Multiplexed, Floating,\n");
 	for (size_t i = 0; i < dbc->message_count; i++)
 		if(msg2csv(dbc->messages[i], output) < 0)
 			return -1;
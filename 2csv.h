@@ -6,8 +6,9 @@ extern "C" {
 #endif
 
 #include "can.h"
+#include "writer.h"
 
-int dbc2csv(dbc_t *dbc, FILE *output);
+int dbc2csv(dbc_t *dbc, writer_t *output);
 
 #ifdef __cplusplus
 }
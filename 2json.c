@@ -8,7 +8,7 @@
 #include <assert.h>
 #include <time.h>
 
-static int print_escaped(FILE *o, const char *string)
+static int print_escaped(writer_t *o, const char *string)
 {
 	assert(o);
 	assert(string);
@@ -16,13 +16,13 @@ static int print_escaped(FILE *o, const char *string)
 	int r = 0;
 	while ((c = *(string)++)) {
 		switch(c) {
-		case '"':  r = fputs("&quot;", o); break;
-		case '\'': r = fputs("&apos;", o); break;
-		case '<':  r = fputs("&lt;",   o); break;
-		case '>':  r = fputs("&gt;",   o); break;
-		case '&':  r = fputs("&amp;",  o); break;
+		case '"':  r = writer_puts(o, "&quot;"); break;
+		case '\'': r = writer_puts(o, "&apos;"); break;
+		case '<':  r = writer_puts(o,   "&lt;"); break;
+		case '>':  r = writer_puts(o,   "&gt;"); break;
+		case '&':  r = writer_puts(o,  "&amp;"); break;
 		default:
-			r = fputc(c, o);
+			r = writer_putc(o, c);
 		}
 		if (r < 0)
 			return -1;
@@ -30,50 +30,43 @@ static int print_escaped(FILE *o, const char *string)
 	return 0;
 }
 
-static int indent(FILE *o, unsigned depth)
-{
-	assert(o);
-	while (depth--)
-		if (fputc('\t', o) != '\t')
-			return -1;
-	return 0;
-}
-
 enum { INT, STRING, BOOL, FLOAT };
 
-static int pfield(FILE *o, unsigned depth, bool last, int type, const char *node, const char *fmt, ...)
+static int pfield(writer_t *o, unsigned depth, bool last, int type, const char *node, const char *fmt, ...)
 {
 	assert(o);
 	assert(node);
 	assert(fmt);
 	va_list args;
 	assert(o && node && fmt);
-	errno = 0;
-	if (indent(o, depth) < 0)
-		goto warn;
-	if (fprintf(o, "\"%s\" : %s", node, type == STRING ? "\"" : "") < 0)
-		goto warn;
+	if (writer_indent(o, depth) < 0)
+		goto fail;
+	writer_putc(o, '"');
+	writer_puts(o, node);
+	if (writer_puts(o, type == STRING ? "\" : \"" : "\" : ") < 0)
+		goto fail;
 	assert(fmt);
 	va_start(args, fmt);
-	int r = vfprintf(o, fmt, args);
+	int r = writer_vprintf(o, fmt, args);
 	va_end(args);
 	if (r < 0)
-		goto warn;
-	if (fprintf(o, "%s%s\n", type == STRING ? "\"" : "", !last ? "," : "") < 0)
-		goto warn;
+		goto fail;
+	if (type == STRING)
+		writer_putc(o, '"');
+	if (writer_puts(o, !last ? ",\n" : "\n") < 0)
+		goto fail;
 	return 0;
-warn:
-	warning("XML node generation, problem writing to FILE* <%p>: %s", o, emsg());
+fail:
 	return -1;
 }
 
-static int signal2json(signal_t *sig, FILE *o, unsigned depth, int multiplexed, int selector, int is_value)
+static int signal2json(signal_t *sig, writer_t *o, unsigned depth, int multiplexed, int selector, int is_value)
 {
 	assert(sig);
 	assert(o);
 	if (!is_value)
-		indent(o, depth);
-	fprintf(o, "{\n");
+		writer_indent(o, depth);
+	writer_puts(o, "{\n");
 	pfield(o, depth+1, false, STRING, "name",      "%s", sig->name);
 	pfield(o, depth+1, false, INT,    "startbit",  "%u", sig->start_bit);
 	pfield(o, depth+1, false, INT,    "bitlength", "%u", sig->bit_length);
@@ -87,30 +80,30 @@ static int signal2json(signal_t *sig, FILE *o, unsigned depth, int multiplexed,
 	if (multiplexed)
 		pfield(o, depth+1, false, STRING, "selector",      "%u", selector);
 
-	indent(o, depth+1);
-	fprintf(o, "\"units\" : \"");
+	writer_indent(o, depth+1);
+	writer_puts(o, "\"units\" : \"");
 	print_escaped(o, sig->units);
-	fprintf(o, "\"\n");
+	writer_puts(o, "\"\n");
 
-	indent(o, depth);
-	if (fprintf(o, "}") < 0)
+	writer_indent(o, depth);
+	if (writer_puts(o, "}") < 0)
 		return -1;
 	return 0;
 }
 
-static int msg2json(can_msg_t *msg, FILE *o, unsigned depth)
+static int msg2json(can_msg_t *msg, writer_t *o, unsigned depth)
 {
 	assert(msg);
 	assert(o);
-	indent(o, depth);
-	fprintf(o, "{\n");
+	writer_indent(o, depth);
+	writer_puts(o, "{\n");
 	pfield(o, depth+1, false, STRING, "name", "%s", msg->name);
 	pfield(o, depth+1, false, INT,    "id",   "%u", msg->id);
 	pfield(o, depth+1, false, INT,    "dlc",  "%u", msg->dlc);
 
 	signal_t *multiplexor = NULL;
-	indent(o, depth+1);
-	fprintf(o, "\"signals\": [\n");
+	writer_indent(o, depth+1);
+	writer_puts(o, "\"signals\": [\n");
 	for (size_t i = 0; i < msg->signal_count; i++) {
 		signal_t *sig = msg->sigs[i];
 		if (sig->is_multiplexor) {
@@ -126,20 +119,20 @@ static int msg2json(can_msg_t *msg, FILE *o, unsigned depth)
 		if (signal2json(sig, o, depth+2, 0, 0, 0) < 0)
 			return -1;
 		if ((msg->signal_count && i < (msg->signal_count - 1)))// || multiplexor)
-			fprintf(o, ",");
-		fprintf(o, "\n");
+			writer_puts(o, ",");
+		writer_puts(o, "\n");
 	}
-	indent(o, depth+1);
-	fprintf(o, "]%s\n", multiplexor ? "," : "");
+	writer_indent(o, depth+1);
+	writer_printf(o, "]%s\n", multiplexor ? "," : "");
 
 	if (multiplexor) {
-		indent(o, depth+1);
-		fprintf(o, "\"multiplexor-group\" : {\n");
-		indent(o, depth+2);
-		fprintf(o, "\"multiplexor\" : ");
+		writer_indent(o, depth+1);
+		writer_puts(o, "\"multiplexor-group\" : {\n");
+		writer_indent(o, depth+2);
+		writer_puts(o, "\"multiplexor\" : ");
 		if (signal2json(multiplexor, o, depth+3, 0, 0, 1) < 0)
 			return -1;
-		fprintf(o, "%s\n", msg->signal_count ? "," : "");
+		writer_printf(o, "%s\n", msg->signal_count ? "," : "");
 		size_t multiplexed_count = 0;
 		for (size_t i = 0; i < msg->signal_count; i++) {
 			signal_t *sig = msg->sigs[i];
@@ -147,8 +140,8 @@ static int msg2json(can_msg_t *msg, FILE *o, unsigned depth)
 				multiplexed_count++;
 		}
 
-		indent(o, depth+2);
-		fprintf(o, "\"multiplexed\" : [\n");
+		writer_indent(o, depth+2);
+		writer_puts(o, "\"multiplexed\" : [\n");
 		for (size_t i = 0, j = 0; i < msg->signal_count; i++) {
 			signal_t *sig = msg->sigs[i];
 			if (!(sig->is_multiplexed))
@@ -157,47 +150,47 @@ static int msg2json(can_msg_t *msg, FILE *o, unsigned depth)
 			if (signal2json(sig, o, depth+3, 1, sig->switchval, 0) < 0)
 				return -1;
 			if (multiplexed_count && j < multiplexed_count)
-				fprintf(o, ",");
-			fprintf(o, "\n");
+				writer_puts(o, ",");
+			writer_puts(o, "\n");
 
 		}
-		indent(o, depth+2);
-		fprintf(o, "]\n");
+		writer_indent(o, depth+2);
+		writer_puts(o, "]\n");
 
-		indent(o, depth+1);
-		fprintf(o, "}\n");
+		writer_indent(o, depth+1);
+		writer_puts(o, "}\n");
 	}
 
-	indent(o, depth);
-	if (fprintf(o, "}") < 0)
+	writer_indent(o, depth);
+	if (writer_puts(o, "}") < 0)
 		return -1;
 	return 0;
 }
 
-int dbc2json(dbc_t *dbc, FILE *output, bool use_time_stamps)
+int dbc2json(dbc_t *dbc, writer_t *output, bool use_time_stamps)
 {
 	assert(dbc);
 	assert(output);
 	time_t rawtime = time(NULL);
 	struct tm *timeinfo = localtime(&rawtime);
 
-	fprintf(output, "{\n");
-	fprintf(output, "\t\"description\" : \"JSON generated from a CAN DBC file\",\n");
-	fprintf(output, "\t\"compiler\" : \"dbcc\",\n");
-	fprintf(output, "\t\"site\" : \"https://github.com/howerj/dbcc\",\n");
+	writer_puts(output, "{\n");
+	writer_puts(output, "\t\"description\" : \"JSON generated from a CAN DBC file\",\n");
+	writer_puts(output, "\t\"compiler\" : \"dbcc\",\n");
+	writer_puts(output, "\t\"site\" : \"https://github.com/howerj/dbcc\",\n");
 	if (use_time_stamps)
-		fprintf(output, "\t\"generated-on\": %s,", asctime(timeinfo));
+		writer_printf(output, "\t\"generated-on\": %s,", asctime(timeinfo));
 
-	fprintf(output, "\t\"messages\" : [\n");
+	writer_puts(output, "\t\"messages\" : [\n");
 	for (size_t i = 0; i < dbc->message_count; i++) {
 		if (msg2json(dbc->messages[i], output, 2) < 0)
 			return -1;
 		if (dbc->message_count && i < (dbc->message_count - 1))
-			fprintf(output, ",");
-		fprintf(output, "\n");
+			writer_puts(output, ",");
+		writer_puts(output, "\n");
 	}
-	fprintf(output, "\t]\n");
-	if (fprintf(output, "}\n") < 0)
+	writer_puts(output, "\t]\n");
+	if (writer_puts(output, "}\n") < 0)
 		return -1;
 	return 0;
 }
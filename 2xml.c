@@ -15,7 +15,7 @@ Add:
 
  */
 
-static int print_escaped(FILE *o, const char *string)
+static int print_escaped(writer_t *o, const char *string)
 {
 	assert(o);
 	assert(string);
@@ -23,13 +23,13 @@ static int print_escaped(FILE *o, const char *string)
 	int r = 0;
 	while((c = *(string)++)) {
 		switch(c) {
-		case '"':  r = fputs("&quot;", o); break;
-		case '\'': r = fputs("&apos;", o); break;
-		case '<':  r = fputs("&lt;",   o); break;
-		case '>':  r = fputs("&gt;",   o); break;
-		case '&':  r = fputs("&amp;",  o); break;
+		case '"':  r = writer_puts(o, "&quot;"); break;
+		case '\'': r = writer_puts(o, "&apos;"); break;
+		case '<':  r = writer_puts(o,   "&lt;"); break;
+		case '>':  r = writer_puts(o,   "&gt;"); break;
+		case '&':  r = writer_puts(o,  "&amp;"); break;
 		default:
-			   r = fputc(c, o);
+			   r = writer_putc(o, c);
 		}
 		if(r < 0)
 			return -1;
@@ -37,72 +37,63 @@ static int print_escaped(FILE *o, const char *string)
 	return 0;
 }
 
-static int indent(FILE *o, unsigned depth)
-{
-	assert(o);
-	while(depth--)
-		if(fputc('\t', o) != '\t')
-			return -1;
-	return 0;
-}
-
-static int pnode(FILE *o, unsigned depth, const char *node, const char *fmt, ...)
+static int pnode(writer_t *o, unsigned depth, const char *node, const char *fmt, ...)
 {
 	assert(o);
 	assert(node);
 	assert(fmt);
 	va_list args;
 	assert(o && node && fmt);
-	errno = 0;
-	if(indent(o, depth) < 0)
-		goto warn;
-	if(fprintf(o, "<%s>", node) < 0)
-		goto warn;
+	if(writer_indent(o, depth) < 0)
+		goto fail;
+	writer_putc(o, '<');
+	writer_puts(o, node);
+	if(writer_putc(o, '>') < 0)
+		goto fail;
 	assert(fmt);
 	va_start(args, fmt);
-	int r = vfprintf(o, fmt, args);
+	int r = writer_vprintf(o, fmt, args);
 	va_end(args);
 	if(r < 0)
-		goto warn;
-	if(fprintf(o, "</%s>\n", node) < 0)
-		goto warn;
+		goto fail;
+	writer_puts(o, "</");
+	writer_puts(o, node);
+	if(writer_puts(o, ">\n") < 0)
+		goto fail;
 	return 0;
-warn:
-	warning("XML node generation, problem writing to FILE* <%p>: %s", o, emsg());
+fail:
 	return -1;
 }
 
-static int comment(FILE *o, unsigned depth, const char *fmt, ...)
+static int comment(writer_t *o, unsigned depth, const char *fmt, ...)
 {
 	assert(o);
 	assert(fmt);
 	va_list args;
 	assert(o && fmt);
-	errno = 0;
-	if(indent(o, depth) < 0)
-		goto warn;
-	if(fputs("<!-- ", o) < 0)
-		goto warn;
+	if(writer_indent(o, depth) < 0)
+		goto fail;
+	if(writer_puts(o, "<!-- ") < 0)
+		goto fail;
 	assert(fmt);
 	va_start(args, fmt);
-	int r = vfprintf(o, fmt, args);
+	int r = writer_vprintf(o, fmt, args);
 	va_end(args);
 	if(r < 0)
-		goto warn;
-	if(fputs(" -->\n", o) < 0)
-		goto warn;
+		goto fail;
+	if(writer_puts(o, " -->\n") < 0)
+		goto fail;
 	return 0;
-warn:
-	warning("XML comment generation, problem writing to FILE* <%p>: %s", o, emsg());
+fail:
 	return -1;
 }
 
-static int signal2xml(signal_t *sig, FILE *o, unsigned depth)
+static int signal2xml(signal_t *sig, writer_t *o, unsigned depth)
 {
 	assert(sig);
 	assert(o);
-	indent(o, depth);
-	fprintf(o, "<signal>\n");
+	writer_indent(o, depth);
+	writer_puts(o, "<signal>\n");
 	pnode(o, depth+1, "name",      "%s", sig->name);
 	pnode(o, depth+1, "startbit",  "%u", sig->start_bit);
 	pnode(o, depth+1, "bitlength", "%u", sig->bit_length);
@@ -114,25 +105,25 @@ static int signal2xml(signal_t *sig, FILE *o, unsigned depth)
 	pnode(o, depth+1, "signed",    "%s", sig->is_signed ? "true" : "false");
 	pnode(o, depth+1, "floating",  "%u", sig->is_floating ? sig->sigval : 0);
 
-	indent(o, depth+1);
-	fprintf(o, "<units>");
-	/*indent(o, depth+2);*/
+	writer_indent(o, depth+1);
+	writer_puts(o, "<units>");
+	/*writer_indent(o, depth+2);*/
 	print_escaped(o, sig->units);
-	/*indent(o, depth+1);*/
-	fprintf(o, "</units>\n");
+	/*writer_indent(o, depth+1);*/
+	writer_puts(o, "</units>\n");
 
-	indent(o, depth);
-	if(fprintf(o, "</signal>\n") < 0)
+	writer_indent(o, depth);
+	if(writer_puts(o, "</signal>\n") < 0)
 		return -1;
 	return 0;
 }
 
-static int msg2xml(can_msg_t *msg, FILE *o, unsigned depth)
+static int msg2xml(can_msg_t *msg, writer_t *o, unsigned depth)
 {
 	assert(msg);
 	assert(o);
-	indent(o, depth);
-	fprintf(o, "<message>\n");
+	writer_indent(o, depth);
+	writer_puts(o, "<message>\n");
 	pnode(o, depth+1, "name", "%s", msg->name);
 	pnode(o, depth+1, "id",   "%u", msg->id);
 	pnode(o, depth+1, "dlc",  "%u", msg->dlc);
@@ -155,57 +146,57 @@ static int msg2xml(can_msg_t *msg, FILE *o, unsigned depth)
 	}
 
 	if(multiplexor) {
-		indent(o, depth+1);
-		fprintf(o, "<multiplexor-group>\n");
-		indent(o, depth+2);
-		fprintf(o, "<multiplexor>\n");
+		writer_indent(o, depth+1);
+		writer_puts(o, "<multiplexor-group>\n");
+		writer_indent(o, depth+2);
+		writer_puts(o, "<multiplexor>\n");
 		if(signal2xml(multiplexor, o, depth+2) < 0)
 			return -1;
-		indent(o, depth+2);
-		fprintf(o, "</multiplexor>\n");
+		writer_indent(o, depth+2);
+		writer_puts(o, "</multiplexor>\n");
 
 		for(size_t i = 0; i < msg->signal_count; i++) {
 			signal_t *sig = msg->sigs[i];
 			if(!(sig->is_multiplexed))
 				continue;
-			indent(o, depth+2);
-			fprintf(o, "<multiplexed>\n");
+			writer_indent(o, depth+2);
+			writer_puts(o, "<multiplexed>\n");
 			pnode(o, depth+3, "multiplexed-on", "%u",  sig->switchval);
 			if(signal2xml(sig, o, depth+3) < 0)
 				return -1;
-			indent(o, depth+2);
-			fprintf(o, "</multiplexed>\n");
+			writer_indent(o, depth+2);
+			writer_puts(o, "</multiplexed>\n");
 		}
-		indent(o, depth+2);
-		fprintf(o, "</multiplexor-group>\n");
+		writer_indent(o, depth+2);
+		writer_puts(o, "</multiplexor-group>\n");
 	}
 
-	indent(o, depth);
-	if(fprintf(o, "</message>\n") < 0)
+	writer_indent(o, depth);
+	if(writer_puts(o, "</message>\n") < 0)
 		return -1;
 	return 0;
 }
 
-int dbc2xml(dbc_t *dbc, FILE *output, bool use_time_stamps)
+int dbc2xml(dbc_t *dbc, writer_t *output, bool use_time_stamps)
 {
 	assert(dbc);
 	assert(output);
 	time_t rawtime = time(NULL);
 	struct tm *timeinfo = localtime(&rawtime);
 
-	fprintf(output, "<?xml version=\"1.0\"?>\n");
-	fprintf(output, "<?xml-stylesheet type=\"text/xsl\" href=\"%s\"?>\n",
+	writer_puts(output, "<?xml version=\"1.0\"?>\n");
+	writer_printf(output, "<?xml-stylesheet type=\"text/xsl\" href=\"%s\"?>\n",
 		"https://raw.githubusercontent.com/howerj/dbcc/master/dbcc.xslt");
 
 	comment(output, 0, "Generated by dbcc (see https://github.com/howerj/dbcc)");
 	if (use_time_stamps)
 		comment(output, 0, "Generated on: %s", asctime(timeinfo));
 
-	fprintf(output, "<candb>\n");
+	writer_puts(output, "<candb>\n");
 	for (size_t i = 0; i < dbc->message_count; i++)
 		if(msg2xml(dbc->messages[i], output, 1) < 0)
 			return -1;
-	if(fprintf(output, "</candb>\n") < 0)
+	if(writer_puts(output, "</candb>\n") < 0)
 		return -1;
 	return 0;
 }
@@ -0,0 +1,84 @@
+/**@file bytes.c
+ * @brief Benchmark unpacking frames received as arrays of bytes, either by
+ * building a 'uint64_t' from the bytes, as suggested in the readme, and
+ * calling 'unpack_message', or by calling 'unpack_bytes'. Packing is checked
+ * to give back the same bytes both ways.
+ * @copyright Richard James Howe
+ * @license MIT */
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define FRAMES (1ul << 16)
+#define ROUNDS (256ul)
+
+static const unsigned long ids[] = {
+#include "ids.h"
+};
+
+static can_bench_h_t bus;
+static uint8_t frames[FRAMES][8];
+
+static uint64_t u64_from_can_msg(const uint8_t m[8])
+{
+	return ((uint64_t)m[7] << 56) | ((uint64_t)m[6] << 48) | ((uint64_t)m[5] << 40) | ((uint64_t)m[4] << 32)
+		| ((uint64_t)m[3] << 24) | ((uint64_t)m[2] << 16) | ((uint64_t)m[1] << 8) | ((uint64_t)m[0] << 0);
+}
+
+static void u64_to_can_msg(const uint64_t u, uint8_t m[8])
+{
+	for (int i = 0; i < 8; i++)
+		m[i] = u >> (i * 8);
+}
+
+static uint32_t xorshift(uint32_t x)
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+int main(void)
+{
+	uint32_t x = 1;
+	for (size_t i = 0; i < FRAMES; i++)
+		for (size_t j = 0; j < 8; j++) {
+			x = xorshift(x);
+			frames[i][j] = x;
+		}
+
+	for (size_t i = 0; i < FRAMES; i++) {
+		const unsigned long id = ids[i % (sizeof ids / sizeof ids[0])];
+		uint8_t by_u64[8] = { 0 }, by_bytes[8] = { 0 };
+		uint64_t u = 0;
+		if (candb_bench_h_unpack_message(&bus, id, u64_from_can_msg(frames[i]), 8, 0) < 0 || candb_bench_h_pack_message(&bus, id, &u) < 0)
+			return 1;
+		u64_to_can_msg(u, by_u64);
+		if (candb_bench_h_unpack_bytes(&bus, id, frames[i], 8, 0) < 0 || candb_bench_h_pack_bytes(&bus, id, by_bytes) < 0)
+			return 1;
+		if (memcmp(by_u64, by_bytes, sizeof by_u64)) {
+			fprintf(stderr, "bytes: frame %zu packs differently\n", i);
+			return 1;
+		}
+	}
+
+	clock_t start = clock();
+	for (unsigned long r = 0; r < ROUNDS; r++)
+		for (size_t i = 0; i < FRAMES; i++)
+			if (candb_bench_h_unpack_message(&bus, ids[0], u64_from_can_msg(frames[i]), 8, 0) < 0)
+				return 1;
+	const double u64_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (unsigned long r = 0; r < ROUNDS; r++)
+		for (size_t i = 0; i < FRAMES; i++)
+			if (candb_bench_h_unpack_bytes(&bus, ids[0], frames[i], 8, 0) < 0)
+				return 1;
+	const double bytes_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%-8s %.2f ns/frame\n", "uint64", u64_seconds * 1e9 / (ROUNDS * FRAMES));
+	printf("%-8s %.2f ns/frame\n", "bytes", bytes_seconds * 1e9 / (ROUNDS * FRAMES));
+	return 0;
+}
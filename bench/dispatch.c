@@ -0,0 +1,77 @@
+/**@file dispatch.c
+ * @brief Benchmark the message dispatch of the generated code, that is the
+ * 'candb_bench_h_unpack_message' function, by decoding a stream of frames
+ * with identifiers picked at random from those in the DBC file. Like on a
+ * real bus a few identifiers carry most of the traffic, the last HOT_IDS
+ * identifiers in the DBC file make up HOT_SHARE percent of the frames.
+ * @copyright Richard James Howe
+ * @license MIT */
+#include "bench.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifndef DISPATCH
+#define DISPATCH "switch"
+#endif
+
+#ifndef HOT_IDS
+#define HOT_IDS (5u)
+#endif
+
+#ifndef HOT_SHARE
+#define HOT_SHARE (60u)
+#endif
+
+#define FRAMES (1ul << 16)
+#define ROUNDS (256ul)
+
+static const unsigned long ids[] = {
+#include "ids.h"
+};
+
+static can_bench_h_t bus;
+static dbcc_frame_t frames[FRAMES];
+
+static uint32_t xorshift(uint32_t x)
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+int main(void)
+{
+	const size_t count = sizeof(ids) / sizeof(ids[0]);
+	uint32_t x = 1;
+	for (size_t i = 0; i < FRAMES; i++) {
+		x = xorshift(x);
+		const bool hot = (x % 100) < HOT_SHARE && count > HOT_IDS;
+		x = xorshift(x);
+		frames[i].id   = hot ? ids[count - 1 - x % HOT_IDS] : ids[x % count];
+		x = xorshift(x);
+		frames[i].data = ((uint64_t)x << 32) | xorshift(x);
+		frames[i].dlc  = 8;
+		frames[i].time_stamp = i;
+	}
+
+	unsigned long decoded = 0;
+	const clock_t start = clock();
+	for (unsigned long r = 0; r < ROUNDS; r++) {
+#ifdef BATCH
+		decoded += candb_bench_h_unpack_messages(&bus, frames, FRAMES);
+#else
+		for (size_t i = 0; i < FRAMES; i++)
+			decoded += candb_bench_h_unpack_message(&bus, frames[i].id, frames[i].data, frames[i].dlc, frames[i].time_stamp) >= 0;
+#endif
+	}
+	const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	if (decoded != ROUNDS * FRAMES) {
+		fprintf(stderr, "%s: only %lu of %lu frames decoded\n", DISPATCH, decoded, ROUNDS * FRAMES);
+		return 1;
+	}
+	printf("%-8s %zu messages: %.2f ns/frame\n", DISPATCH, count, seconds * 1e9 / (ROUNDS * FRAMES));
+	return 0;
+}
@@ -0,0 +1,67 @@
+/**@file extract.c
+ * @brief Benchmark getting the physical value of one signal out of a log of
+ * frames for one message, first by unpacking and decoding each frame and then
+ * with the column extraction function made by the '-e' option.
+ * @copyright Richard James Howe
+ * @license MIT */
+#include "bench.h"
+#include <stdio.h>
+#include <time.h>
+
+#define FRAMES (1ul << 16)
+#define ROUNDS (256ul)
+
+static const unsigned long ids[] = {
+#include "ids.h"
+};
+
+static can_bench_h_t bus;
+static dbcc_frame_t frames[FRAMES];
+static uint64_t data[FRAMES];
+static double by_frame[FRAMES], by_column[FRAMES];
+static int in_range[FRAMES];
+
+static uint32_t xorshift(uint32_t x)
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+int main(void)
+{
+	uint32_t x = 1;
+	for (size_t i = 0; i < FRAMES; i++) {
+		x = xorshift(x);
+		frames[i].id   = ids[0];
+		frames[i].data = ((uint64_t)x << 32) | xorshift(x);
+		frames[i].dlc  = 8;
+		frames[i].time_stamp = i;
+		data[i] = frames[i].data;
+	}
+
+	clock_t start = clock();
+	for (unsigned long r = 0; r < ROUNDS; r++)
+		for (size_t i = 0; i < FRAMES; i++) {
+			if (candb_bench_h_unpack_message(&bus, frames[i].id, frames[i].data, frames[i].dlc, frames[i].time_stamp) < 0)
+				return 1;
+			in_range[i] = candb_decode_bench_h_Signal0B(&bus, &by_frame[i]) == 0;
+		}
+	const double frame_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (unsigned long r = 0; r < ROUNDS; r++)
+		candb_extract_decode_bench_h_Signal0B(data, FRAMES, by_column);
+	const double column_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	/* extraction does not do range checks */
+	for (size_t i = 0; i < FRAMES; i++)
+		if (in_range[i] && by_frame[i] != by_column[i]) {
+			fprintf(stderr, "extract: frame %zu decoded as %g, extracted as %g\n", i, by_frame[i], by_column[i]);
+			return 1;
+		}
+	printf("%-8s %.2f ns/frame\n", "frame", frame_seconds * 1e9 / (ROUNDS * FRAMES));
+	printf("%-8s %.2f ns/frame\n", "column", column_seconds * 1e9 / (ROUNDS * FRAMES));
+	return 0;
+}
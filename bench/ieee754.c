@@ -0,0 +1,80 @@
+/**@file ieee754.c
+ * @brief Benchmark unpacking and then packing again a message with floating
+ * point signals, either two floats (float_signal.dbc) or a double
+ * (double_signal.dbc, with DOUBLE defined). The payloads are random bit
+ * patterns of finite numbers, so the exponents cover the whole range. Built
+ * with DBCC_IEEE754 defined as 0 the portable conversions are used.
+ * @copyright Richard James Howe
+ * @license MIT */
+#ifdef DOUBLE
+#include "double_signal.h"
+#define SIGNAL "double"
+#define UNPACK candb_double_signal_h_unpack_message
+#define PACK   candb_double_signal_h_pack_message
+typedef can_double_signal_h_t bus_t;
+#else
+#include "float_signal.h"
+#define SIGNAL "float"
+#define UNPACK candb_float_signal_h_unpack_message
+#define PACK   candb_float_signal_h_pack_message
+typedef can_float_signal_h_t bus_t;
+#endif
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifndef MODE
+#define MODE "fast"
+#endif
+
+#define ID     (0x400ul)
+#define FRAMES (1ul << 12)
+#define ROUNDS (1024ul)
+
+static bus_t bus;
+static uint64_t data[FRAMES];
+
+static uint32_t xorshift(uint32_t x)
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static bool is_finite(uint64_t d)
+{
+#ifdef DOUBLE
+	return ((d >> 52) & 0x7FF) != 0x7FF;
+#else
+	return ((d >> 23) & 0xFF) != 0xFF && ((d >> 55) & 0xFF) != 0xFF;
+#endif
+}
+
+int main(void)
+{
+	uint32_t x = 1;
+	for (size_t i = 0; i < FRAMES;) {
+		x = xorshift(x);
+		const uint32_t high = x;
+		x = xorshift(x);
+		const uint64_t d = ((uint64_t)high << 32) | x;
+		if (is_finite(d))
+			data[i++] = d;
+	}
+
+	unsigned long same = 0;
+	const clock_t start = clock();
+	for (unsigned long r = 0; r < ROUNDS; r++)
+		for (size_t i = 0; i < FRAMES; i++) {
+			uint64_t packed = 0;
+			if (UNPACK(&bus, ID, data[i], 8, 0) < 0 || PACK(&bus, ID, &packed) < 0)
+				return 1;
+			same += packed == data[i];
+		}
+	const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%-6s %-8s %.2f ns/frame, %.1f%% of frames unchanged by unpack and pack\n",
+			SIGNAL, MODE, seconds * 1e9 / (ROUNDS * FRAMES), 100.0 * same / (ROUNDS * FRAMES));
+	return 0;
+}
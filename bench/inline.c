@@ -0,0 +1,62 @@
+/**@file inline.c
+ * @brief Benchmark unpacking a log of frames for one message and decoding
+ * its signals, with the code generated by default ('call') and with '-i'
+ * ('inline'), which defines the decode functions in the header so they can
+ * be inlined into the loop.
+ * @copyright Richard James Howe
+ * @license MIT */
+#include "bench.h"
+#include <stdio.h>
+#include <time.h>
+
+#ifndef MODE
+#define MODE "call"
+#endif
+
+#define FRAMES (1ul << 16)
+#define ROUNDS (256ul)
+
+static const unsigned long ids[] = {
+#include "ids.h"
+};
+
+static can_bench_h_t bus;
+static dbcc_frame_t frames[FRAMES];
+
+static uint32_t xorshift(uint32_t x)
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+int main(void)
+{
+	uint32_t x = 1;
+	for (size_t i = 0; i < FRAMES; i++) {
+		x = xorshift(x);
+		frames[i].id   = ids[0];
+		frames[i].data = ((uint64_t)x << 32) | xorshift(x);
+		frames[i].dlc  = 8;
+		frames[i].time_stamp = i;
+	}
+
+	double sum = 0;
+	unsigned long errors = 0;
+	const clock_t start = clock();
+	for (unsigned long r = 0; r < ROUNDS; r++)
+		for (size_t i = 0; i < FRAMES; i++) {
+			uint16_t a = 0;
+			double b = 0;
+			if (candb_bench_h_unpack_message(&bus, frames[i].id, frames[i].data, frames[i].dlc, frames[i].time_stamp) < 0)
+				return 1;
+			errors += candb_decode_bench_h_Signal0A(&bus, &a) < 0;
+			errors += candb_decode_bench_h_Signal0B(&bus, &b) < 0;
+			sum += a + b;
+		}
+	const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%-8s %.2f ns/frame (sum %g, %lu out of range)\n", MODE, seconds * 1e9 / (ROUNDS * FRAMES), sum, errors);
+	return 0;
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Make a DBC file for the benchmarks with STANDARD messages that have random
+# 11-bit identifiers and EXTENDED messages with random 29-bit identifiers.
+STANDARD=${1:-200}
+EXTENDED=${2:-800}
+awk -v standard="${STANDARD}" -v extended="${EXTENDED}" 'BEGIN {
+	srand(1);
+	printf "VERSION \"\"\n\n\nNS_ : \n\tCM_\n\tBA_\n\tVAL_\n\tSIG_VALTYPE_\n\nBS_:\n\nBU_: Node0\n\n\n";
+	for (n = 0; n < standard + extended;) {
+		id = n < standard ? int(rand() * 2048) : 2048 + int(rand() * (536870912 - 2048));
+		if (id in used)
+			continue;
+		used[id] = 1;
+		printf "BO_ %d Message%d: 8 Node0\n", id, n;
+		printf " SG_ Signal%dA : 0|16@1+ (1,0) [0|65535] \"\" Vector__XXX\n", n;
+		printf " SG_ Signal%dB : 16|16@1- (0.5,0) [-16384|16383] \"\" Vector__XXX\n\n", n;
+		n++;
+	}
+}'
@@ -412,3 +412,44 @@ dbc_t *ast2dbc(mpc_ast_t *ast)
 }
 
 
+
+static signal_t *find_signal(can_msg_t *msg, const char *name)
+{
+	assert(msg);
+	assert(name);
+	for (size_t i = 0; i < msg->signal_count; i++)
+		if (!strcmp(msg->sigs[i]->name, name))
+			return msg->sigs[i];
+	return NULL;
+}
+
+int dbc_replace_message(dbc_t *dbc, size_t index, mpc_ast_t *ast)
+{
+	assert(dbc);
+	assert(ast);
+	assert(index < dbc->message_count);
+	can_msg_t *old = dbc->messages[index];
+	can_msg_t *msg = ast2msg(ast, ast, dbc);
+	if (msg->id != old->id)
+		goto fail;
+
+	/* The comments and signal types are given by other records, which
+	 * have not changed, so they can be taken from the old message */
+	for (size_t i = 0; i < msg->signal_count; i++) {
+		signal_t *sig = msg->sigs[i];
+		signal_t *was = find_signal(old, sig->name);
+		if (!was)
+			goto fail;
+		sig->sigval      = was->sigval;
+		sig->is_floating = was->is_floating;
+		sig->comment     = was->comment ? duplicate(was->comment) : NULL;
+	}
+	msg->comment = old->comment ? duplicate(old->comment) : NULL;
+
+	dbc->messages[index] = msg;
+	can_msg_delete(old);
+	return 0;
+fail:
+	can_msg_delete(msg);
+	return -1;
+}
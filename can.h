@@ -78,6 +78,12 @@ typedef struct {
 dbc_t *ast2dbc(mpc_ast_t *ast);
 void dbc_delete(dbc_t *dbc);
 
+/* Replace message 'index' with one made from the AST of a single 'BO_'
+ * record, keeping the comments and signal types given to it elsewhere in the
+ * file. Returns -1, leaving 'dbc' unchanged, if the identifier changed or a
+ * signal was added, as those would need the rest of the file reparsing. */
+int dbc_replace_message(dbc_t *dbc, size_t index, mpc_ast_t *ast);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,26 @@
+/* Check that unpacking with change detection (dbcc -d) marks exactly the
+ * signals whose bits changed, that the first frame of a message marks all of
+ * them and that a repeated payload only updates the time stamp of its message. */
+#include "check.h"
+
+static uint64_t unpack(can_ext_h_t *o, uint64_t data, dbcc_time_stamp_t time_stamp)
+{
+	expect("unpack", candb_ext_h_unpack_message(o, 0x100, data, 8, time_stamp), 0);
+	return o->can_Message0_0x100_changed;
+}
+
+int main(void)
+{
+	static can_ext_h_t o;
+	const uint64_t all = can_Message0_0x100_CHANGED_Flags0 | can_Message0_0x100_CHANGED_Offset0
+		| can_Message0_0x100_CHANGED_Count0 | can_Message0_0x100_CHANGED_Level0;
+	expect("first frame", unpack(&o, payload(1, 0, 2, 0), 1), all);
+	expect("same payload", unpack(&o, payload(1, 0, 2, 0), 2), 0);
+	expect("time stamp", o.can_Message0_0x100_time_stamp_rx, 2);
+	expect("big endian signal", unpack(&o, payload(1, 0, 0x102, 0), 3), can_Message0_0x100_CHANGED_Count0);
+	expect("value", o.can_Message0_0x100.Count0, 0x102);
+	expect("sign bit", unpack(&o, payload(1, -2048, 0x102, 0), 4), can_Message0_0x100_CHANGED_Offset0);
+	expect("all", unpack(&o, payload(2, 1, 0x103, -1), 5), all);
+	expect("last payload", o.can_Message0_0x100_raw == payload(2, 1, 0x103, -1), 1);
+	return report();
+}
@@ -0,0 +1,37 @@
+/* Helpers for the checks of the code generated for 'ext.dbc', whose first
+ * message (0x100) has an unsigned byte 'Flags0' in bits 0 to 7, a signed 12
+ * bit 'Offset0' in bits 8 to 19 scaled by 0.5 with an offset of -10, a big
+ * endian 16 bit 'Count0' in bytes 4 and 5 and a signed byte 'Level0' in bits
+ * 56 to 63. */
+#ifndef CHECK_H
+#define CHECK_H
+#include "ext.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+static void expect(const char *what, long long got, long long wanted)
+{
+	if (got == wanted)
+		return;
+	fprintf(stderr, "%s: %s: got %lld, wanted %lld\n", MODE, what, got, wanted);
+	failures++;
+}
+
+static int report(void)
+{
+	printf("%s: %s\n", MODE, failures ? "FAIL" : "pass");
+	return !!failures;
+}
+
+/* payload of message 0x100 with the raw values of its signals */
+static uint64_t payload(uint8_t flags, int offset, uint16_t count, int8_t level)
+{
+	return (uint64_t)flags
+		| (uint64_t)(offset & 0xfff) << 8
+		| (uint64_t)(count >> 8) << 32
+		| (uint64_t)(count & 0xff) << 40
+		| (uint64_t)(uint8_t)level << 56;
+}
+
+#endif
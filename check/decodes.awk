@@ -0,0 +1,18 @@
+# List the decode functions in a generated header, with the encode function
+# for the same signal, the type of the signal and what to divide its value by
+# to get the physical value, as DECODE(decode, encode, type, divisor)
+/physical value is the value \// {
+	divisor = $(NF - 1)
+}
+/^(static inline )?int candb_decode_[A-Za-z0-9_]*\(/ {
+	name = $0
+	sub(/\(.*/, "", name)
+	sub(/.* /, "", name)
+	type = $0
+	sub(/ \*out\).*/, "", type)
+	sub(/.*, /, "", type)
+	encode = name
+	sub(/^candb_decode_/, "candb_encode_", encode)
+	printf "\tDECODE(%s, %s, %s, %s)\n", name, encode, type, divisor ? divisor : 1
+	divisor = 0
+}
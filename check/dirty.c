@@ -0,0 +1,36 @@
+/* Check that the dirty flag set by encoding a signal (dbcc -n) only reports
+ * messages whose contents have really changed, in particular encoding the same
+ * in range value twice must leave the message clean. */
+#include "ex1.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+static void expect(const char *what, size_t got, size_t wanted)
+{
+	if (got == wanted)
+		return;
+	fprintf(stderr, "%s: %s: got %u, wanted %u\n", MODE, what, (unsigned)got, (unsigned)wanted);
+	failures++;
+}
+
+int main(void)
+{
+	static can_ex1_h_t o;
+	dbcc_frame_t frames[8];
+	expect("initially clean", candb_ex1_h_pack_dirty(&o, frames, 8), 0);
+	expect("encode", candb_encode_ex1_h_FrameFaultCommandValue_0x028(&o, 5), 0);
+	expect("changed value", candb_ex1_h_pack_dirty(&o, frames, 8), 1);
+	expect("frame identifier", frames[0].id, 0x028);
+	expect("cleared once packed", candb_ex1_h_pack_dirty(&o, frames, 8), 0);
+	expect("encode", candb_encode_ex1_h_FrameFaultCommandValue_0x028(&o, 5), 0);
+	expect("same value", candb_ex1_h_pack_dirty(&o, frames, 8), 0);
+	expect("encode", candb_encode_ex1_h_FrameFaultCommandCode_0x028(&o, 5), 0);
+	expect("other signal", candb_ex1_h_pack_dirty(&o, frames, 8), 1);
+	expect("encode", candb_encode_ex1_h_FrameFaultCommandValue_0x028(&o, -5), 0);
+	expect("negative value", candb_ex1_h_pack_dirty(&o, frames, 8), 1);
+	expect("encode", candb_encode_ex1_h_FrameFaultCommandValue_0x028(&o, -5), 0);
+	expect("same negative value", candb_ex1_h_pack_dirty(&o, frames, 8), 0);
+	printf("%s: %s\n", MODE, failures ? "FAIL" : "pass");
+	return !!failures;
+}
@@ -0,0 +1,51 @@
+/* Check that readers of the buffered state of all messages (dbcc -E) keep
+ * seeing the copy they pinned while newer ones are published, and that
+ * publishing fails instead of overwriting a pinned copy. */
+#include "check.h"
+
+static uint16_t count(const can_ext_h_t *o)
+{
+	return o->can_Message0_0x100.Count0;
+}
+
+static void receive(can_ext_h_epochs_t *b, uint16_t value)
+{
+	expect("unpack", candb_ext_h_unpack_message(candb_ext_h_writing(b), 0x100, payload(0, 0, value, 0), 8, 0), 0);
+}
+
+int main(void)
+{
+	static can_ext_h_epochs_t b;
+	unsigned long epoch = 99;
+	candb_ext_h_epochs_init(&b);
+	const can_ext_h_t *r1 = candb_ext_h_pin(&b, &epoch);
+	expect("never published", epoch, 0);
+	candb_ext_h_unpin(&b, r1);
+
+	receive(&b, 1000);
+	expect("publish", candb_ext_h_publish(&b), 0);
+	r1 = candb_ext_h_pin(&b, &epoch);
+	expect("first epoch", epoch, 1);
+	expect("first copy", count(r1), 1000);
+	expect("writer carries on", count(candb_ext_h_writing(&b)), 1000);
+
+	receive(&b, 2000);
+	expect("publish while pinned", candb_ext_h_publish(&b), 0);
+	const can_ext_h_t *r2 = candb_ext_h_pin(&b, &epoch);
+	expect("second epoch", epoch, 2);
+	expect("second copy", count(r2), 2000);
+	expect("pinned copy kept", count(r1), 1000);
+	candb_ext_h_unpin(&b, r2);
+
+	/* the writer, the latest copy and the one still pinned use all three */
+	receive(&b, 3000);
+	expect("every buffer busy", candb_ext_h_publish(&b), -1);
+	expect("pinned copy untouched", count(r1), 1000);
+	candb_ext_h_unpin(&b, r1);
+	expect("publish once unpinned", candb_ext_h_publish(&b), 0);
+	r1 = candb_ext_h_pin(&b, &epoch);
+	expect("third epoch", epoch, 3);
+	expect("third copy", count(r1), 3000);
+	candb_ext_h_unpin(&b, r1);
+	return report();
+}
@@ -0,0 +1,41 @@
+/* Check that the extraction functions (dbcc -e) give the same values for a
+ * signal across many payloads as unpacking and decoding each of them. */
+#include "check.h"
+
+#define FRAMES (37) /* not a multiple of any vector width */
+
+int main(void)
+{
+	static can_ext_h_t o;
+	uint64_t data[FRAMES];
+	uint16_t count[FRAMES];
+	int16_t offset[FRAMES];
+	double physical[FRAMES];
+	uint8_t flags[FRAMES];
+	int8_t level[FRAMES];
+	for (int i = 0; i < FRAMES; i++)
+		data[i] = payload(i * 7, i * 113 - 2048, i * 1771, i * 7 - 128);
+	candb_extract_ext_h_Count0_0x100(data, FRAMES, count);
+	candb_extract_ext_h_Offset0_0x100(data, FRAMES, offset);
+	candb_extract_decode_ext_h_Offset0_0x100(data, FRAMES, physical);
+	candb_extract_ext_h_Flags0_0x100(data, FRAMES, flags);
+	candb_extract_ext_h_Level0_0x100(data, FRAMES, level);
+	for (int i = 0; i < FRAMES; i++) {
+		expect("unpack", candb_ext_h_unpack_message(&o, 0x100, data[i], 8, 0), 0);
+		uint16_t c = 0;
+		uint8_t f = 0;
+		int8_t l = 0;
+		double p = 0;
+		candb_decode_ext_h_Count0_0x100(&o, &c);
+		candb_decode_ext_h_Flags0_0x100(&o, &f);
+		candb_decode_ext_h_Level0_0x100(&o, &l);
+		candb_decode_ext_h_Offset0_0x100(&o, &p);
+		expect("big endian", count[i], c);
+		expect("unsigned", flags[i], f);
+		expect("signed", level[i], l);
+		expect("sign extended", offset[i], o.can_Message0_0x100.Offset0);
+		expect("scaled", physical[i] * 2, p * 2);
+		expect("scaled value", physical[i] * 2, (i * 113 - 2048) - 20);
+	}
+	return report();
+}
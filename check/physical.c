@@ -0,0 +1,33 @@
+/* Check that unpacking a payload straight into decoded values (dbcc -F) gives
+ * the values the decode functions do, that packing them gives the payload
+ * back and that a value out of range is not packed. */
+#include "check.h"
+
+int main(void)
+{
+	static can_ext_h_t o;
+	for (int i = 0; i < 37; i++) {
+		const uint64_t data = payload(i * 7, i * 113 - 2048, i * 1771, i * 7 - 128);
+		can_Message0_0x100_physical_t p;
+		expect("unpack physical", candb_unpack_physical_ext_h_can_Message0_0x100(&p, data, 8), 0);
+		expect("unpack", candb_ext_h_unpack_message(&o, 0x100, data, 8, 0), 0);
+		uint16_t c = 0;
+		uint8_t f = 0;
+		int8_t l = 0;
+		double v = 0;
+		candb_decode_ext_h_Count0_0x100(&o, &c);
+		candb_decode_ext_h_Flags0_0x100(&o, &f);
+		candb_decode_ext_h_Level0_0x100(&o, &l);
+		candb_decode_ext_h_Offset0_0x100(&o, &v);
+		expect("big endian", p.Count0, c);
+		expect("unsigned", p.Flags0, f);
+		expect("signed", p.Level0, l);
+		expect("scaled", p.Offset0 * 2, v * 2);
+		uint64_t packed = 0;
+		expect("pack physical", candb_pack_physical_ext_h_can_Message0_0x100(&p, &packed), 0);
+		expect("round trip", packed == data, 1);
+		p.Offset0 = 1014;
+		expect("out of range", candb_pack_physical_ext_h_can_Message0_0x100(&p, &packed), -1);
+	}
+	return report();
+}
@@ -0,0 +1,55 @@
+/* Check that frames pushed on the receive queue (dbcc -Q) are unpacked in
+ * order when drained, at most as many as asked for at a time, that frames
+ * pushed while the queue is full are counted and dropped, and that frames
+ * pushed by another thread all arrive in order. */
+#include "check.h"
+#include <pthread.h>
+
+#define FRAMES (200000)
+
+static can_ext_h_t o;
+static dbcc_queue_t q;
+
+static void *producer(void *arg)
+{
+	(void)arg;
+	for (long k = 1; k <= FRAMES; k++)
+		while (dbcc_queue_push(&q, 0x100, payload(k, 0, k, 0), 8, k) < 0)
+			;
+	return NULL;
+}
+
+int main(void)
+{
+	expect("empty", candb_ext_h_drain(&o, &q, 8), 0);
+	for (unsigned k = 0; k < DBCC_QUEUE_LENGTH; k++)
+		expect("push", dbcc_queue_push(&q, k % 2 ? 0x100 : 0x12345, payload(k, 0, k, 0), 8, k), 0);
+	expect("full", dbcc_queue_push(&q, 0x100, payload(0, 0, 0, 0), 8, 0), -1);
+	expect("dropped", q.dropped, 1);
+	expect("drain some", candb_ext_h_drain(&o, &q, 10), 10);
+	expect("in order", o.can_Message0_0x100.Count0, 9);
+	expect("time stamp", o.can_Message0_0x100_time_stamp_rx, 9);
+	expect("space again", dbcc_queue_push(&q, 0x100, payload(0, 0, 1000, 0), 8, 1000), 0);
+	expect("drain rest", candb_ext_h_drain(&o, &q, 1000), DBCC_QUEUE_LENGTH - 10 + 1);
+	expect("last frame", o.can_Message0_0x100.Count0, 1000);
+	expect("drained", candb_ext_h_drain(&o, &q, 8), 0);
+
+	pthread_t t;
+	if (pthread_create(&t, NULL, producer, NULL)) {
+		fprintf(stderr, "%s: cannot create thread\n", MODE);
+		return 1;
+	}
+	size_t drained = 0;
+	long out_of_order = 0;
+	dbcc_time_stamp_t last = 0;
+	while (drained < FRAMES) {
+		if (!candb_ext_h_drain(&o, &q, 1))
+			continue;
+		drained++;
+		out_of_order += o.can_Message0_0x100_time_stamp_rx != ++last;
+	}
+	pthread_join(t, NULL);
+	expect("out of order", out_of_order, 0);
+	expect("all frames", o.can_Message0_0x100_time_stamp_rx, FRAMES);
+	return report();
+}
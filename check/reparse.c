@@ -0,0 +1,161 @@
+/* Check that reparsing only the edited message records of a DBC file, as
+ * watch mode does, gives the same model as parsing the whole edited file, and
+ * that the edits it cannot apply in place (a new or renamed signal, a changed
+ * identifier, changes outside of the message records) are refused so the
+ * whole file is parsed again instead. */
+#include "parse.h"
+#include "util.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void expect(const char *what, long got, long wanted)
+{
+	if (got == wanted)
+		return;
+	fprintf(stderr, "reparse: %s: got %ld, wanted %ld\n", what, got, wanted);
+	failures++;
+}
+
+static dbc_t *load(const char *text)
+{
+	mpc_ast_t *ast = parse_dbc_string(text);
+	if (!ast)
+		return NULL;
+	dbc_t *dbc = ast2dbc(ast);
+	mpc_ast_delete(ast);
+	return dbc;
+}
+
+/* 'text' with the first 'from' replaced by 'to' */
+static char *edit(const char *text, const char *from, const char *to)
+{
+	const char *at = strstr(text, from);
+	if (!at) {
+		fprintf(stderr, "reparse: no '%s' to edit\n", from);
+		failures++;
+		return duplicate(text);
+	}
+	char *r = allocate(strlen(text) - strlen(from) + strlen(to) + 1);
+	memcpy(r, text, at - text);
+	strcat(r, to);
+	strcat(r, at + strlen(from));
+	return r;
+}
+
+static int same_string(const char *a, const char *b)
+{
+	return a == b || (a && b && !strcmp(a, b));
+}
+
+static int same_number(double a, double b)
+{
+	return a == b || (isnan(a) && isnan(b));
+}
+
+static int same_signal(const signal_t *a, const signal_t *b)
+{
+	return same_string(a->name, b->name)
+		&& same_string(a->units, b->units)
+		&& same_string(a->comment, b->comment)
+		&& same_number(a->scaling, b->scaling)
+		&& same_number(a->offset, b->offset)
+		&& same_number(a->minimum, b->minimum)
+		&& same_number(a->maximum, b->maximum)
+		&& a->bit_length == b->bit_length
+		&& a->start_bit == b->start_bit
+		&& a->endianess == b->endianess
+		&& a->is_signed == b->is_signed
+		&& a->is_floating == b->is_floating
+		&& a->sigval == b->sigval
+		&& a->is_multiplexor == b->is_multiplexor
+		&& a->is_multiplexed == b->is_multiplexed
+		&& a->switchval == b->switchval
+		&& a->ecu_count == b->ecu_count
+		&& !a->val_list == !b->val_list;
+}
+
+static int same_dbc(const dbc_t *a, const dbc_t *b)
+{
+	if (a->message_count != b->message_count || a->use_float != b->use_float)
+		return 0;
+	for (size_t i = 0; i < a->message_count; i++) {
+		const can_msg_t *m = a->messages[i], *n = b->messages[i];
+		if (!same_string(m->name, n->name) || !same_string(m->ecu, n->ecu) || !same_string(m->comment, n->comment))
+			return 0;
+		if (m->id != n->id || m->dlc != n->dlc || m->signal_count != n->signal_count)
+			return 0;
+		for (size_t j = 0; j < m->signal_count; j++)
+			if (!same_signal(m->sigs[j], n->sigs[j]))
+				return 0;
+	}
+	return 1;
+}
+
+/* apply an edit, expecting 'reparsed' message records to be reparsed or -1
+ * if the edit has to be refused */
+static void check(const char *what, const char *text, const char *from, const char *to, long reparsed)
+{
+	dbc_t *dbc = load(text);
+	char *edited = edit(text, from, to);
+	const int r = parse_dbc_update(dbc, text, edited);
+	expect(what, r, reparsed);
+	if (r >= 0) {
+		dbc_t *full = load(edited);
+		expect(what, full && same_dbc(dbc, full), 1);
+		dbc_delete(full);
+	}
+	dbc_delete(dbc);
+	free(edited);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s file.dbc\n", argv[0]);
+		return 1;
+	}
+	FILE *f = fopen(argv[1], "rb");
+	if (!f) {
+		fprintf(stderr, "reparse: cannot open '%s'\n", argv[1]);
+		return 1;
+	}
+	char *text = slurp(f);
+	fclose(f);
+
+	check("unchanged", text, "BO_", "BO_", 0);
+	check("scaling", text,
+		"SG_ MagicNode1Flags : 0|16@1+ (1,0) [0|65535]",
+		"SG_ MagicNode1Flags : 0|16@1+ (0.5,-3) [-3|32764.5]", 1);
+	check("length and sender", text, "BO_ 35 MagicCanNode2Heartbeat: 2 Vector__XXX",
+		"BO_ 35 MagicCanNode2Heartbeat: 3 Node2", 1);
+	check("byte order and sign", text, "SG_ Odometer_Velocity : 7|32@0-", "SG_ Odometer_Velocity : 0|32@1+", 1);
+	check("new signal", text,
+		" SG_ MagicNode1Flags : 0|16@1+ (1,0) [0|65535] \"\" Vector__XXX\n",
+		" SG_ MagicNode1Flags : 0|16@1+ (1,0) [0|65535] \"\" Vector__XXX\n"
+		" SG_ MagicNode1Extra : 16|8@1+ (1,0) [0|255] \"\" Vector__XXX\n", -1);
+	check("signal renamed", text, "SG_ Cell13 : 0|15@1-", "SG_ Cell13Voltage : 0|15@1-", -1);
+	check("signal removed", text, " SG_ Cell13 : 0|15@1- (1,0) [-16384|16383] \"\" Vector__XXX\n", "", 1);
+	check("identifier", text, "BO_ 35 MagicCanNode2Heartbeat", "BO_ 1900 MagicCanNode2Heartbeat", -1);
+	check("syntax error", text, "SG_ Cell13 : 0|15@1-", "SG_ Cell13 : 0|15@", -1);
+	check("outside of messages", text, "BU_:", "BU_: Node2", -1);
+
+	/* two records edited at once */
+	char *first = edit(text, "SG_ Cell13 : 0|15@1- (1,0)", "SG_ Cell13 : 0|15@1- (2,0)");
+	dbc_t *dbc = load(text);
+	char *second = edit(first, "SG_ MagicNode3Flags : 0|16@1+", "SG_ MagicNode3Flags : 0|15@1+");
+	expect("two records", parse_dbc_update(dbc, text, second), 2);
+	dbc_t *full = load(second);
+	expect("two records", full && same_dbc(dbc, full), 1);
+	dbc_delete(full);
+	dbc_delete(dbc);
+	free(second);
+	free(first);
+
+	free(text);
+	parse_cleanup();
+	fprintf(stderr, "reparse: %s\n", failures ? "FAIL" : "pass");
+	return !!failures;
+}
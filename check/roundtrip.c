@@ -0,0 +1,167 @@
+/* Check that the code generated for a DBC file with the options under test
+ * (MODE) packs and unpacks each message the same way as the code generated
+ * without any: this prints what it makes of a fixed series of frames, the
+ * packed frames on "P" lines and the physical value of every signal on "D"
+ * lines, which the makefile compares with what the plain build prints. Code
+ * that stores messages as payloads (PAYLOAD) packs the bits no signal covers
+ * as they were received, so only its "D" lines are compared and it must give
+ * back each payload unchanged instead. Encoding the decoded values again must
+ * not change the packed frames, the batch, byte array and can_frame forms of
+ * unpack and pack must agree with the scalar ones and identifiers not in the
+ * DBC file must be rejected. */
+#include HEADER
+#include <stdio.h>
+#include <string.h>
+
+#define CAT_(A, B, C) A ## B ## C
+#define CAT(A, B, C)  CAT_(A, B, C)
+#define API(F)        CAT(candb_, DBC, _h_ ## F)
+#define BUS           CAT(can_, DBC, _h_t)
+
+#define ROUNDS (16)
+
+typedef struct {
+	unsigned long id;
+	uint8_t dlc;
+} message_t;
+
+static const message_t messages[] = {
+#include IDS
+};
+
+#define MESSAGES (sizeof(messages) / sizeof(messages[0]))
+
+static int failures = 0;
+
+static void fail(const char *what, unsigned long id)
+{
+	fprintf(stderr, "%s: %s: 0x%lx\n", MODE, what, id);
+	failures++;
+}
+
+#define DECODE(DECODE, ENCODE, TYPE, DIVISOR) {\
+	TYPE v = 0;\
+	const int r = DECODE(o, &v);\
+	printf("D %s %d %.9g\n", #DECODE, r, (double)v / DIVISOR);\
+	if (r >= 0 && ENCODE(o, v) < 0)\
+		fail(#ENCODE, 0);\
+}
+
+/* decode every signal and encode it again */
+static void decodes(BUS *o)
+{
+#include DECODES
+}
+
+static uint64_t random64(void)
+{
+	static uint64_t s = 0x9E3779B97F4A7C15ull;
+	s ^= s << 13;
+	s ^= s >> 7;
+	s ^= s << 17;
+	return s;
+}
+
+/* unpack and pack a frame again with the byte array and can_frame forms,
+ * which must give the results 'u' and 'p' of the scalar forms */
+static void byte_forms(const dbcc_frame_t *f, int u, int p, uint64_t packed)
+{
+	static BUS o;
+	uint8_t bytes[8] = { 0 }, out[8] = { 0 };
+	uint64_t data = 0;
+	for (size_t i = 0; i < 8; i++)
+		bytes[i] = f->data >> (i * 8);
+	if (API(unpack_bytes)(&o, f->id, bytes, f->dlc, f->time_stamp) != u)
+		fail("bytes unpacked differently", f->id);
+	const int r = API(pack_bytes)(&o, f->id, out);
+	for (size_t i = 0; i < 8; i++)
+		data |= (uint64_t)out[i] << (i * 8);
+	if (r != p || (r >= 0 && data != packed))
+		fail("bytes packed differently", f->id);
+#if DBCC_CAN_FRAME
+	struct can_frame frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.can_id  = f->id > CAN_SFF_MASK ? f->id | CAN_EFF_FLAG : f->id;
+	frame.can_dlc = f->dlc;
+	memcpy(frame.data, bytes, sizeof(bytes));
+	if (API(unpack_can_frame)(&o, &frame, f->time_stamp) != u)
+		fail("can_frame unpacked differently", f->id);
+	memset(frame.data, 0, sizeof(frame.data));
+	if (API(pack_can_frame)(&o, &frame) != p || (p >= 0 && memcmp(frame.data, out, sizeof(out))))
+		fail("can_frame packed differently", f->id);
+	frame.can_id |= CAN_RTR_FLAG;
+	if (API(unpack_can_frame)(&o, &frame, f->time_stamp) >= 0)
+		fail("remote frame unpacked", f->id);
+#endif
+}
+
+static int known(unsigned long id)
+{
+	for (size_t i = 0; i < MESSAGES; i++)
+		if (messages[i].id == id)
+			return 1;
+	return 0;
+}
+
+int main(void)
+{
+	static BUS o, batch;
+	static dbcc_frame_t frames[MESSAGES], out[MESSAGES];
+	static uint64_t packs[MESSAGES];
+	static int results[MESSAGES];
+	for (size_t round = 0; round < ROUNDS; round++) {
+		size_t unpacked = 0, packed = 0;
+		for (size_t i = 0; i < MESSAGES; i++) {
+			dbcc_frame_t *f = &frames[i];
+			f->id   = messages[i].id;
+			f->dlc  = messages[i].dlc;
+			f->data = messages[i].dlc >= 8 ? random64() : random64() & ((1ull << (messages[i].dlc * 8)) - 1);
+			f->time_stamp = round;
+			uint64_t data = 0;
+			const int u = API(unpack_message)(&o, f->id, f->data, f->dlc, round);
+			const int p = API(pack_message)(&o, f->id, &data);
+			printf("P %lx %d %d %016llx\n", f->id, u, p, (unsigned long long)data);
+#ifdef PAYLOAD
+			if (u >= 0 && p >= 0 && data != f->data)
+				fail("payload changed", f->id);
+#endif
+			byte_forms(f, u, p, data);
+			unpacked  += u >= 0;
+			packed    += p >= 0;
+			packs[i]   = data;
+			results[i] = p;
+		}
+
+		if (API(unpack_messages)(&batch, frames, MESSAGES) != unpacked)
+			fail("batch unpacked differently", 0);
+		memcpy(out, frames, sizeof(out));
+		if (API(pack_messages)(&batch, out, MESSAGES) != packed)
+			fail("batch packed differently", 0);
+		for (size_t i = 0; i < MESSAGES; i++)
+			if (results[i] >= 0 && out[i].data != packs[i])
+				fail("batch packed differently", messages[i].id);
+
+		decodes(&o);
+		for (size_t i = 0; i < MESSAGES; i++) {
+			uint64_t data = 0;
+			if (results[i] >= 0 && (API(pack_message)(&o, messages[i].id, &data) < 0 || data != packs[i]))
+				fail("encoded differently", messages[i].id);
+		}
+	}
+
+	for (size_t i = 0; i < MESSAGES; i++) {
+		const unsigned long id = messages[i].id;
+		const unsigned long probes[] = { id ^ 1ul, id ^ 0x400ul, id ^ 0x10000ul, id + 0x20000000ul };
+		for (size_t j = 0; j < sizeof(probes) / sizeof(probes[0]); j++) {
+			uint64_t data = 0;
+			if (known(probes[j]))
+				continue;
+			if (API(unpack_message)(&o, probes[j], 0, 8, 0) >= 0)
+				fail("unknown identifier unpacked", probes[j]);
+			if (API(pack_message)(&o, probes[j], &data) >= 0)
+				fail("unknown identifier packed", probes[j]);
+		}
+	}
+	fprintf(stderr, "%s: %s\n", MODE, failures ? "FAIL" : "pass");
+	return !!failures;
+}
@@ -0,0 +1,46 @@
+/* Check that a reader taking snapshots of a message (dbcc -l) while another
+ * thread unpacks it never sees the signals of two different frames mixed. */
+#include "check.h"
+#include <pthread.h>
+
+#define FRAMES (200000)
+
+static can_ext_h_t o;
+static atomic_int done;
+
+static void *writer(void *arg)
+{
+	(void)arg;
+	for (long k = 1; k <= FRAMES; k++)
+		candb_ext_h_unpack_message(&o, 0x100, payload(k, k & 0x7ff, k, k >> 8), 8, k);
+	atomic_store(&done, 1);
+	return NULL;
+}
+
+int main(void)
+{
+	can_ext_h_t copy;
+	expect("nothing received", candb_snapshot_ext_h_can_Message0_0x100(&o, &copy), -1);
+	pthread_t t;
+	if (pthread_create(&t, NULL, writer, NULL)) {
+		fprintf(stderr, "%s: cannot create thread\n", MODE);
+		return 1;
+	}
+	long torn = 0;
+	while (!atomic_load(&done)) {
+		if (candb_snapshot_ext_h_can_Message0_0x100(&o, &copy) < 0)
+			continue;
+		const can_Message0_0x100_t *m = &copy.can_Message0_0x100;
+		const unsigned k = m->Count0;
+		torn += m->Flags0 != (k & 0xff)
+			|| (m->Offset0 & 0x7ff) != (int)(k & 0x7ff)
+			|| m->Level0 != (int8_t)(k >> 8)
+			|| (copy.can_Message0_0x100_time_stamp_rx & 0xffff) != k;
+	}
+	pthread_join(t, NULL);
+	expect("torn snapshots", torn, 0);
+	expect("sequence number", atomic_load(&o.can_Message0_0x100_seq), 2 * FRAMES);
+	expect("last snapshot", candb_snapshot_ext_h_can_Message0_0x100(&o, &copy), 0);
+	expect("last frame", copy.can_Message0_0x100.Count0, FRAMES & 0xffff);
+	return report();
+}
@@ -0,0 +1,36 @@
+#!/bin/sh
+# Check that the output a server (dbcc -S) sends back to a client (dbcc -a)
+# is the same as generating it directly, both for a file the server has not
+# seen and for one it has cached a model of and that has since been edited.
+set -e
+DBCC=${1:-../bin/dbcc}
+DBC=${2:-../ex1.dbc}
+OPTS="-c -j -r -e"
+rm -rf server
+mkdir -p server/direct server/client
+cp "${DBC}" server/ex1.dbc
+
+${DBCC} -S server/sock 2> /dev/null &
+PID=$!
+trap 'kill ${PID} 2> /dev/null || true' EXIT
+i=0
+while [ ! -S server/sock ]; do
+	i=$((i + 1))
+	[ ${i} -lt 50 ] || { echo "server: did not start"; exit 1; }
+	sleep 0.1
+done
+
+for pass in new edited; do
+	${DBCC} ${OPTS} -o server/direct server/ex1.dbc 2> /dev/null
+	${DBCC} -a server/sock ${OPTS} -o server/client server/ex1.dbc 2> /dev/null
+	diff -r server/direct server/client > /dev/null || { echo "server: ${pass}: fail"; exit 1; }
+	echo "server: ${pass}: pass"
+	# the edit may leave the stamp of the file as it was, in which case
+	# the server has to compare the contents to see it
+	sed 's/MagicCanNode1RHeartbeat/MagicCanNode1REdited/' "${DBC}" > server/ex1.dbc
+done
+grep -q MagicCanNode1REdited server/client/ex1.h || { echo "server: edit not seen"; exit 1; }
+
+kill ${PID}
+wait ${PID} || true
+[ ! -e server/sock ] || { echo "server: socket left behind"; exit 1; }
@@ -0,0 +1,39 @@
+/* Check that messages unpacked into shared memory (dbcc -M) can be read
+ * through a read only mapping of it, and that the mapping is refused while
+ * the object is not set up or was made with a different version. */
+#define _POSIX_C_SOURCE 200809L
+#include "check.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+int main(void)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "/dbcc-check-%ld", (long)getpid());
+	expect("attach before create", candb_ext_h_shm_attach(name) == NULL, 1);
+	can_ext_h_shm_t *w = candb_ext_h_shm_create(name);
+	if (!w) {
+		fprintf(stderr, "%s: cannot create shared memory '%s'\n", MODE, name);
+		return 1;
+	}
+	const can_ext_h_shm_t *r = candb_ext_h_shm_attach(name);
+	expect("attach", r != NULL, 1);
+	if (r) {
+		can_ext_h_t copy;
+		expect("nothing received", candb_snapshot_ext_h_can_Message0_0x100(&r->bus, &copy), -1);
+		expect("unpack", candb_ext_h_unpack_message(&w->bus, 0x100, payload(1, -2, 3000, -4), 8, 5), 0);
+		expect("snapshot", candb_snapshot_ext_h_can_Message0_0x100(&r->bus, &copy), 0);
+		expect("unsigned", copy.can_Message0_0x100.Flags0, 1);
+		expect("signed", copy.can_Message0_0x100.Offset0, -2);
+		expect("big endian", copy.can_Message0_0x100.Count0, 3000);
+		expect("signed byte", copy.can_Message0_0x100.Level0, -4);
+		expect("time stamp", copy.can_Message0_0x100_time_stamp_rx, 5);
+		expect("detach", candb_ext_h_shm_detach(r), 0);
+	}
+
+	w->version++;
+	expect("other version", candb_ext_h_shm_attach(name) == NULL, 1);
+	expect("detach writer", candb_ext_h_shm_detach(w), 0);
+	shm_unlink(name);
+	return report();
+}
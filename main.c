@@ -2,7 +2,11 @@
  * @brief dbcc - produce serialization and deserialization code for CAN DBC files
  * @copyright Richard James Howe
  * @license MIT */
+#define _XOPEN_SOURCE 700 /* for sockets, 'sigaction' and 'realpath' */
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
 #include <stdint.h>
 #include "mpc.h"
 #include "util.h"
@@ -15,18 +19,41 @@
 #include "2json.h"
 #include "options.h"
 
+/* server and client modes use Unix domain sockets */
+#if defined(__unix__) || defined(__APPLE__)
+#define DBCC_SERVER (1)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#else
+#define DBCC_SERVER (0)
+#endif
+
+#define DBCC_WATCH_PERIOD_MS    (250u)
+#define DBCC_CACHE_SIZE         (16u)   /* models kept by a server */
+#define DBCC_MAX_OPTIONS        (64)    /* options in a server request */
+#define DBCC_MAX_RECORD         (64ul * 1024ul * 1024ul)
+#define DBCC_REQUEST_TIMEOUT_S  (10)
+#define DBCC_RUNTIME_HEADER     "dbcc_runtime.h"
+
+/* options that change what is generated, and so are sent with a request to a
+ * server, as opposed to those that change how this program runs */
+#define GENERATION_OPTIONS "cbjxCNtTeFIiDfrLlEMdRQnpuksP:"
+
 typedef enum {
-	CONVERT_TO_C,
-	CONVERT_TO_XML,
-	CONVERT_TO_CSV,
-	CONVERT_TO_BSM,
-	CONVERT_TO_JSON,
+	CONVERT_TO_C    = 1u << 0,
+	CONVERT_TO_XML  = 1u << 1,
+	CONVERT_TO_CSV  = 1u << 2,
+	CONVERT_TO_BSM  = 1u << 3,
+	CONVERT_TO_JSON = 1u << 4,
 } conversion_type_e;
 
 static void usage(const char *arg0)
 {
 	assert(arg0);
-	fprintf(stderr, "%s: [-] [-hvjgtxpkuDC] [-o dir] file*\n", arg0);
+	fprintf(stderr, "%s: [-] [-hvcjgtTxpkuswDCeFIfirLlEMdRQn] [-o dir] [-P profile] [-S socket] [-a socket] file*\n", arg0);
 }
 
 static void help(void)
@@ -40,19 +67,41 @@ Options:\n\
 \t-v     make the program more verbose\n\
 \t-g     print out the grammar used to parse the DBC files\n\
 \t-t     add timestamps to the generated files\n\
-\t-x     convert output to XML instead of the default C code\n\
-\t-C     convert output to CSV instead of the default C code\n\
-\t-b     convert output to BSM (beSTORM) instead of the default C code\n\
-\t-j     convert output to JSON instead of the default C code\n\
+\t-c     convert output to C code (the default if no other output is given)\n\
+\t-x     convert output to XML\n\
+\t-C     convert output to CSV\n\
+\t-b     convert output to BSM (beSTORM)\n\
+\t-j     convert output to JSON\n\
 \t-D     use 'double' for the encode/decode type messages\n\
+\t-f     use 'float' instead of 'double' for scaled signals\n\
+\t-T     dispatch on message identifier with tables instead of a switch\n\
+\t-e     generate functions to extract a signal from many frames at once\n\
+\t-F     generate functions to unpack/pack messages to/from decoded values\n\
+\t-I     use integer fixed point instead of 'double' for scaled signals\n\
+\t-i     define the pack/unpack/encode/decode functions inline in the header\n\
+\t-r     write the helper functions once, to dbcc_runtime.h, and include it\n\
+\t-L     keep the state of each message together on its own cache line\n\
+\t-l     protect each message with a sequence lock for lock free readers\n\
+\t-E     buffer the state of all messages, readers pin a published epoch\n\
+\t-M     share the state of all messages in POSIX shared memory, implies -l\n\
+\t-d     skip unpacking unchanged payloads, record which signals changed\n\
+\t-R     store each message as its payload, decode signals from it on demand\n\
+\t-Q     generate a queue for interrupt handlers to push received frames into\n\
+\t-n     mark messages whose signals change, to pack only those messages\n\
 \t-o dir set the output directory\n\
+\t-P file check the most frequent IDs in this frame profile first\n\
 \t-p     generate only print code\n\
 \t-k     generate only pack code\n\
 \t-u     generate only unpack code\n\
 \t-s     disable assert generation\n\
+\t-S sock serve generate requests on a Unix domain socket\n\
+\t-a sock have the server on a Unix domain socket generate the output\n\
+\t-w     watch the files and regenerate the output when they change\n\
 \tfile   process a DBC file\n\
 \n\
-Files must come after the arguments have been processed.\n\
+Files must come after the arguments have been processed. Output options can\n\
+be combined, each file is then parsed once and all of the outputs are\n\
+generated from it.\n\
 \n\
 The parser combinator library (mpc) used in this program is licensed from\n\
 Daniel Holden, Copyright (c) 2013, under the BSD3 license\n\
@@ -78,90 +127,995 @@ static char *replace_file_type(const char *file, const char *suffix)
 	return name;
 }
 
+static int frame_count_id_compare(const void *a, const void *b)
+{
+	assert(a);
+	assert(b);
+	const frame_count_t *ap = a;
+	const frame_count_t *bp = b;
+	if (ap->id < bp->id) return -1;
+	if (ap->id > bp->id) return  1;
+	return 0;
+}
+
+/* Read a frame frequency profile. Each line is either an identifier and the
+ * number of frames seen with it, such as "0x123 1042", or a line of a log
+ * made by 'candump -l', such as "(1436509052.249713) can0 123#11223344",
+ * which counts as one frame. Other lines are ignored. */
+static int load_profile(const char *name, dbc2c_options_t *copts)
+{
+	assert(name);
+	assert(copts);
+	FILE *f = fopen(name, "rb");
+	if (!f)
+		return -1;
+	size_t used = 0, size = 64;
+	frame_count_t *p = allocate(sizeof(*p) * size);
+	char line[512];
+	while (fgets(line, sizeof(line), f)) {
+		frame_count_t fc = { .id = 0, .count = 1 };
+		char *end = NULL;
+		if (line[0] == '(') { /* candump log: "(time) interface id#data" */
+			char *hash = strchr(line, '#');
+			if (!hash)
+				continue;
+			char *id = hash;
+			while (id > line && !isspace((unsigned char)id[-1]))
+				id--;
+			fc.id = strtoul(id, &end, 16);
+			if (end != hash)
+				continue;
+		} else {
+			fc.id = strtoul(line, &end, 0);
+			if (end == line)
+				continue;
+			fc.count = strtoul(end, &end, 0);
+		}
+		if (used == size) {
+			size *= 2;
+			p = reallocator(p, sizeof(*p) * size);
+		}
+		p[used++] = fc;
+	}
+	const int r = ferror(f) ? -1 : 0;
+	fclose(f);
+
+	/* merge the counts for each identifier */
+	qsort(p, used, sizeof(*p), frame_count_id_compare);
+	size_t merged = 0;
+	for (size_t i = 0; i < used; i++) {
+		if (merged && p[merged - 1].id == p[i].id)
+			p[merged - 1].count += p[i].count;
+		else
+			p[merged++] = p[i];
+	}
+	free(copts->profile);
+	copts->profile = p;
+	copts->profile_count = merged;
+	return r;
+}
+
+/* In watch mode the output is generated in memory and a file is only
+ * written if its contents have changed, so that whatever builds the generated
+ * code does not rebuild it for every edit to the DBC file. */
+static bool write_only_if_changed = false;
+
+/* While a server is answering a request the output is generated in memory
+ * and sent to the client as records on this stream instead of to files. */
+static FILE *reply = NULL;
+
+/* Requests to a server and its replies are a series of records, each a
+ * keyword and a length on a line followed by that many bytes and a new line,
+ * "file 12\n/tmp/ex1.dbc\n" for example. */
+static int record_write(FILE *f, const char *keyword, const char *data, size_t length)
+{
+	assert(f);
+	assert(keyword);
+	assert(data);
+	if (fprintf(f, "%s %lu\n", keyword, (unsigned long)length) < 0)
+		return -1;
+	if (fwrite(data, 1, length, f) != length || fputc('\n', f) == EOF)
+		return -1;
+	return 0;
+}
+
+/* Read a record, returning its data NUL terminated, which must be freed, and
+ * its keyword in 'keyword'. NULL is returned at the end of the input or if
+ * the record is malformed. */
+static char *record_read(FILE *f, char *keyword, size_t size, size_t *length)
+{
+	assert(f);
+	assert(keyword);
+	assert(length);
+	char line[128];
+	if (!fgets(line, sizeof(line), f))
+		return NULL;
+	const char *space = strchr(line, ' ');
+	if (!space || (size_t)(space - line) >= size)
+		return NULL;
+	char *end = NULL;
+	const unsigned long l = strtoul(space + 1, &end, 10);
+	if (end == space + 1 || *end != '\n' || l > DBCC_MAX_RECORD)
+		return NULL;
+	memcpy(keyword, line, space - line);
+	keyword[space - line] = '\0';
+	char *data = allocate(l + 1);
+	if (fread(data, 1, l, f) != l || fgetc(f) != '\n') {
+		free(data);
+		return NULL;
+	}
+	*length = l;
+	return data;
+}
+
+typedef struct {
+	char *name;   /**< output file name */
+	FILE *file;   /**< open output file, NULL if generating in memory */
+	writer_t *w;  /**< writer the converters use */
+} output_t;
+
+static writer_t *output_create(output_t *o, char *name, bool in_memory)
+{
+	assert(o);
+	assert(name);
+	o->name = name;
+	if (in_memory || reply) {
+		o->file = NULL;
+		o->w    = writer_new_memory();
+	} else {
+		o->file = fopen_or_die(o->name, "wb");
+		o->w    = writer_new(o->file);
+	}
+	return o->w;
+}
+
+static writer_t *output_open(output_t *o, const char *dbc_file, const char *suffix)
+{
+	assert(o);
+	assert(dbc_file);
+	assert(suffix);
+	return output_create(o, replace_file_type(dbc_file, suffix), write_only_if_changed);
+}
+
+static int output_close(output_t *o, int r)
+{
+	assert(o);
+	if (!o->file && r >= 0 && !writer_error(o->w)) {
+		size_t length = 0;
+		const char *contents = writer_contents(o->w, &length);
+		if (reply) {
+			if (record_write(reply, "name", o->name, strlen(o->name)) < 0
+					|| record_write(reply, "output", contents, length) < 0)
+				r = -1;
+		} else if (file_contents_equal(o->name, contents, length)) {
+			debug("unchanged => %s", o->name);
+		} else {
+			FILE *f = fopen_or_die(o->name, "wb");
+			if (fwrite(contents, 1, length, f) != length)
+				r = -1;
+			if (fclose(f) < 0)
+				r = -1;
+		}
+	}
+	if (writer_delete(o->w) < 0)
+		r = -1;
+	if (o->file && fclose(o->file) < 0)
+		r = -1;
+	free(o->name);
+	return r;
+}
+
 static int dbc2cWrapper(dbc_t *dbc, const char *dbc_file, const char *file_only, dbc2c_options_t *copts)
 {
 	assert(dbc);
 	assert(dbc_file);
 	assert(file_only);
-	char *cname = replace_file_type(dbc_file,  "c");
-	char *hname = replace_file_type(dbc_file,  "h");
+	output_t c, h;
 	char *fname = replace_file_type(file_only, "h");
-	FILE *c = fopen_or_die(cname, "wb");
-	FILE *h = fopen_or_die(hname, "wb");
-	const int r = dbc2c(dbc, c, h, fname, copts);
-	fclose(c);
-	fclose(h);
-	free(cname);
-	free(hname);
+	writer_t *cw = output_open(&c, dbc_file, "c");
+	writer_t *hw = output_open(&h, dbc_file, "h");
+	int r = dbc2c(dbc, cw, hw, fname, copts);
+	if (output_close(&c, r) < 0)
+		r = -1;
+	if (output_close(&h, r) < 0)
+		r = -1;
 	free(fname);
 	return r;
 }
 
+/* The runtime header is shared by all of the C files generated into a
+ * directory, it is only written if it has changed so that every file that
+ * includes it is not rebuilt each time dbcc is run */
+static int dbc2c_runtimeWrapper(const char *outdir)
+{
+	static const char *runtime = DBCC_RUNTIME_HEADER;
+	char *name = allocate((outdir ? strlen(outdir) + 1 : 0) + strlen(runtime) + 1);
+	if (outdir) {
+		strcat(name, outdir);
+		strcat(name, "/");
+	}
+	strcat(name, runtime);
+	output_t o;
+	writer_t *w = output_create(&o, name, true);
+	return output_close(&o, dbc2c_runtime(w));
+}
+
 static int dbc2xmlWrapper(dbc_t *dbc, const char *dbc_file, bool use_time_stamps)
 {
 	assert(dbc);
 	assert(dbc_file);
-	char *name = replace_file_type(dbc_file, "xml");
-	FILE *o = fopen_or_die(name, "wb");
-	const int r = dbc2xml(dbc, o, use_time_stamps);
-	fclose(o);
-	free(name);
-	return r;
+	output_t o;
+	writer_t *w = output_open(&o, dbc_file, "xml");
+	return output_close(&o, dbc2xml(dbc, w, use_time_stamps));
 }
 
 static int dbc2csvWrapper(dbc_t *dbc, const char *dbc_file)
 {
 	assert(dbc);
 	assert(dbc_file);
-	char *name = replace_file_type(dbc_file, "csv");
-	FILE *o = fopen_or_die(name, "wb");
-	const int r = dbc2csv(dbc, o);
-	fclose(o);
-	free(name);
-	return r;
+	output_t o;
+	writer_t *w = output_open(&o, dbc_file, "csv");
+	return output_close(&o, dbc2csv(dbc, w));
 }
 
 static int dbc2bsmWrapper(dbc_t *dbc, const char *dbc_file, bool use_time_stamps)
 {
 	assert(dbc);
 	assert(dbc_file);
-	char *name = replace_file_type(dbc_file, "bsm");
-	FILE *o = fopen_or_die(name, "wb");
-	const int r = dbc2bsm(dbc, o, use_time_stamps);
-	fclose(o);
-	free(name);
-	return r;
+	output_t o;
+	writer_t *w = output_open(&o, dbc_file, "bsm");
+	return output_close(&o, dbc2bsm(dbc, w, use_time_stamps));
 }
 
 static int dbc2jsonWrapper(dbc_t *dbc, const char *dbc_file, bool use_time_stamps)
 {
 	assert(dbc);
 	assert(dbc_file);
-	char *name = replace_file_type(dbc_file, "json");
-	FILE *o = fopen_or_die(name, "wb");
-	const int r = dbc2json(dbc, o, use_time_stamps);
-	fclose(o);
-	free(name);
+	output_t o;
+	writer_t *w = output_open(&o, dbc_file, "json");
+	return output_close(&o, dbc2json(dbc, w, use_time_stamps));
+}
+
+static dbc_t *load_file(const char *file, const char *text)
+{
+	assert(file);
+	debug("reading => %s", file);
+	mpc_ast_t *ast = text ? parse_dbc_named_string(file, text) : parse_dbc_file_by_name(file);
+	if(!ast) {
+		warning("could not parse file '%s'", file);
+		return NULL;
+	}
+	if(verbose(LOG_DEBUG))
+		mpc_ast_print(ast);
+	dbc_t *dbc = ast2dbc(ast);
+	mpc_ast_delete(ast);
+	return dbc;
+}
+
+static int generate(dbc_t *dbc, char *file, unsigned convert, const char *outdir, dbc2c_options_t *copts)
+{
+	assert(dbc);
+	assert(file);
+	assert(copts);
+	int r = 0;
+	char *outpath = dbcc_basename(file);
+	if(outdir) {
+		outpath = allocate(strlen(outpath) + strlen(outdir) + 2 /* '/' + '\0'*/);
+		strcat(outpath, outdir);
+		strcat(outpath, "/");
+		strcat(outpath, dbcc_basename(file));
+	}
+
+	if ((convert & CONVERT_TO_XML) && dbc2xmlWrapper(dbc, outpath, copts->use_time_stamps) < 0) {
+		warning("XML conversion failed: %s", file);
+		r = -1;
+	}
+	if ((convert & CONVERT_TO_CSV) && dbc2csvWrapper(dbc, outpath) < 0) {
+		warning("CSV conversion failed: %s", file);
+		r = -1;
+	}
+	if ((convert & CONVERT_TO_BSM) && dbc2bsmWrapper(dbc, outpath, copts->use_time_stamps) < 0) {
+		warning("BSM conversion failed: %s", file);
+		r = -1;
+	}
+	if ((convert & CONVERT_TO_JSON) && dbc2jsonWrapper(dbc, outpath, copts->use_time_stamps) < 0) {
+		warning("JSON conversion failed: %s", file);
+		r = -1;
+	}
+	if ((convert & CONVERT_TO_C) && dbc2cWrapper(dbc, outpath, dbcc_basename(file), copts) < 0) {
+		warning("C conversion failed: %s", file);
+		r = -1;
+	}
+
+	if(outdir)
+		free(outpath);
 	return r;
 }
 
-int main(int argc, char **argv)
+static int process_file(char *file, unsigned convert, const char *outdir, dbc2c_options_t *copts)
 {
-	log_level_e log_level = get_log_level();
-	conversion_type_e convert = CONVERT_TO_C;
-	const char *outdir = NULL;
-	dbc2c_options_t copts = {
+	assert(file);
+	assert(copts);
+	dbc_t *dbc = load_file(file, NULL);
+	if (!dbc)
+		return -1;
+	const int r = generate(dbc, file, convert, outdir, copts);
+	dbc_delete(dbc);
+	return r;
+}
+
+typedef struct {
+	file_stamp_t stamp; /**< modification time and size when last read */
+	time_t read;        /**< when the file was last read or compared */
+	char *text;         /**< contents of the file 'dbc' was made from */
+	dbc_t *dbc;         /**< model of the file, NULL if it did not parse */
+} watched_t;
+
+static char *read_file(const char *name)
+{
+	assert(name);
+	FILE *f = fopen(name, "rb");
+	if (!f)
+		return NULL;
+	char *text = slurp(f);
+	fclose(f);
+	return text;
+}
+
+/* Bring the model of a watched file up to date with its contents; when only
+ * some message records have been edited just those are reparsed, which on a
+ * large DBC file is far quicker than parsing the whole file again. */
+static void watch_update(watched_t *w, const char *file, char *text)
+{
+	assert(w);
+	assert(file);
+	assert(text);
+	if (w->dbc) {
+		const int reparsed = parse_dbc_update(w->dbc, w->text, text);
+		if (reparsed >= 0) {
+			debug("reparsed %d message%s => %s", reparsed, reparsed == 1 ? "" : "s", file);
+			free(w->text);
+			w->text = text;
+			return;
+		}
+		dbc_delete(w->dbc);
+	}
+	free(w->text);
+	w->text = text;
+	w->dbc  = load_file(file, text);
+}
+
+/* Check a watched file for changes and bring its model up to date if it has
+ * changed, returning 1 if it has, 0 if not and -1 if it could not be read. A
+ * file rewritten with the same size within the resolution of its time stamp
+ * (a second on some file systems) keeps the same stamp, so while the stamp is
+ * no older than the last read the contents are compared as well. */
+static int watch_poll(watched_t *w, const char *file)
+{
+	assert(w);
+	assert(file);
+	file_stamp_t now = { .modified = 0, .nanoseconds = 0, .size = 0 };
+	if (file_stamp(file, &now) < 0)
+		return -1;
+	const bool same = file_stamp_equal(&now, &w->stamp);
+	if (same && (!w->text || now.modified < w->read))
+		return 0;
+	const time_t read = time(NULL);
+	if (same && file_contents_equal(file, w->text, strlen(w->text))) {
+		w->read = read;
+		return 0;
+	}
+	char *text = read_file(file);
+	if (!text)
+		return -1;
+	w->read  = read;
+	w->stamp = now;
+	watch_update(w, file, text);
+	return 1;
+}
+
+/* set by SIGINT or SIGTERM, so that watch and server modes can clean up and
+ * return */
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int sig)
+{
+	UNUSED(sig);
+	stopping = 1;
+}
+
+/* Watch mode; poll the input files and regenerate the output for any that
+ * have changed, until the program is interrupted. Polling the modification
+ * time and size is used instead of inotify(7) so it works on every platform. */
+static int watch_files(char **files, int count, unsigned convert, const char *outdir, dbc2c_options_t *copts)
+{
+	assert(files);
+	assert(copts);
+	watched_t *watched = allocate(sizeof(*watched) * count);
+	for (int i = 0; i < count; i++) {
+		if (watch_poll(&watched[i], files[i]) < 0)
+			warning("cannot watch '%s': %s", files[i], emsg());
+		if (watched[i].dbc)
+			generate(watched[i].dbc, files[i], convert, outdir, copts);
+	}
+	note("watching %d file%s for changes", count, count == 1 ? "" : "s");
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+	while (!stopping) {
+		sleep_ms(DBCC_WATCH_PERIOD_MS);
+		for (int i = 0; i < count; i++) {
+			/* a file that cannot be read may be in the middle of
+			 * being replaced by an editor, it is tried again */
+			if (watch_poll(&watched[i], files[i]) <= 0)
+				continue;
+			note("regenerating => %s", files[i]);
+			if (watched[i].dbc)
+				generate(watched[i].dbc, files[i], convert, outdir, copts);
+		}
+	}
+	note("stopped watching");
+	for (int i = 0; i < count; i++) {
+		dbc_delete(watched[i].dbc);
+		free(watched[i].text);
+	}
+	free(watched);
+	return 0;
+}
+
+static void options_default(dbc2c_options_t *copts)
+{
+	assert(copts);
+	const dbc2c_options_t defaults = {
 		.use_id_in_name            =  true,
 		.use_time_stamps           =  false,
 		.use_doubles_for_encoding  =  false,
+		.use_floats_for_encoding   =  false,
 		.generate_print            =  false,
 		.generate_pack             =  false,
 		.generate_unpack           =  false,
 		.generate_asserts          =  false,
+		.use_dispatch_table        =  false,
+		.generate_extract          =  false,
+		.generate_physical         =  false,
+		.use_fixed_point           =  false,
+		.generate_inline           =  false,
+		.use_runtime               =  false,
+		.use_cache_line_layout     =  false,
+		.use_seqlock               =  false,
+		.use_epochs                =  false,
+		.use_shared_memory         =  false,
+		.use_change_detection      =  false,
+		.use_lazy_decoding         =  false,
+		.use_rx_queue              =  false,
+		.use_dirty_tracking        =  false,
+		.profile                   =  NULL,
+		.profile_count             =  0,
 	};
+	*copts = defaults;
+}
+
+/* Apply one of the GENERATION_OPTIONS, returning 1 if 'opt' is one of them,
+ * 0 if it is not and -1 if its argument is bad */
+static int generation_option(int opt, const char *arg, unsigned *convert, dbc2c_options_t *copts)
+{
+	assert(convert);
+	assert(copts);
+	switch (opt) {
+	case 'c':
+		*convert |= CONVERT_TO_C;
+		break;
+	case 'b':
+		*convert |= CONVERT_TO_BSM;
+		break;
+	case 'j':
+		*convert |= CONVERT_TO_JSON;
+		break;
+	case 'x':
+		*convert |= CONVERT_TO_XML;
+		break;
+	case 'C':
+		*convert |= CONVERT_TO_CSV;
+		break;
+	case 'N':
+		copts->use_id_in_name = false;
+		break;
+	case 't':
+		copts->use_time_stamps = true;
+		debug("using time stamps");
+		break;
+	case 'T':
+		copts->use_dispatch_table = true;
+		debug("using dispatch tables");
+		break;
+	case 'e':
+		copts->generate_extract = true;
+		debug("generating extraction functions");
+		break;
+	case 'F':
+		copts->generate_physical = true;
+		debug("generating physical value functions");
+		break;
+	case 'I':
+		copts->use_fixed_point = true;
+		debug("using fixed point for scaled signals");
+		break;
+	case 'i':
+		copts->generate_inline = true;
+		debug("defining functions inline in the header");
+		break;
+	case 'r':
+		copts->use_runtime = true;
+		debug("using the run time header");
+		break;
+	case 'L':
+		copts->use_cache_line_layout = true;
+		debug("using a cache line per message");
+		break;
+	case 'l':
+		copts->use_seqlock = true;
+		debug("using sequence locks");
+		break;
+	case 'E':
+		copts->use_epochs = true;
+		debug("buffering the state of all messages");
+		break;
+	case 'M':
+		copts->use_shared_memory = true;
+		copts->use_seqlock = true;
+		debug("sharing the state of all messages in shared memory");
+		break;
+	case 'd':
+		copts->use_change_detection = true;
+		debug("detecting changes in payloads");
+		break;
+	case 'R':
+		copts->use_lazy_decoding = true;
+		debug("storing messages as payloads");
+		break;
+	case 'Q':
+		copts->use_rx_queue = true;
+		debug("generating a receive queue");
+		break;
+	case 'n':
+		copts->use_dirty_tracking = true;
+		debug("tracking changed messages");
+		break;
+	case 'D':
+		copts->use_doubles_for_encoding = true;
+		debug("using doubles for encoding");
+		break;
+	case 'f':
+		copts->use_floats_for_encoding = true;
+		debug("using floats for scaled signals");
+		break;
+	case 'p':
+		copts->generate_print = true;
+		debug("generate code for print");
+		break;
+	case 'u':
+		copts->generate_unpack = true;
+		debug("generate code for unpack");
+		break;
+	case 'k':
+		copts->generate_pack = true;
+		debug("generate code for pack");
+		break;
+	case 's':
+		copts->generate_asserts = false;
+		debug("asserts disabled - apparently you think silent corruption is a good thing");
+		break;
+	case 'P':
+		assert(arg);
+		if (load_profile(arg, copts) < 0)
+			return -1;
+		debug("profile: %s", arg);
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+/* Fill in the defaults that depend on the other options once they have all
+ * been given, returning -1 if they conflict */
+static int options_finish(unsigned *convert, dbc2c_options_t *copts)
+{
+	assert(convert);
+	assert(copts);
+	if (!*convert)
+		*convert = CONVERT_TO_C;
+
+	if ((*convert & CONVERT_TO_CSV) && copts->use_time_stamps)
+		return -1;
+
+	if (copts->use_fixed_point && copts->use_doubles_for_encoding)
+		warning("fixed point option ignored, all encode/decode functions use 'double'");
+	if (copts->use_floats_for_encoding && copts->use_doubles_for_encoding)
+		warning("float option ignored, all encode/decode functions use 'double'");
+
+	if (!copts->generate_unpack && !copts->generate_pack && !copts->generate_print) {
+		copts->generate_print  = false;
+		copts->generate_pack   = true;
+		copts->generate_unpack = true;
+	}
+	return 0;
+}
+
+#if DBCC_SERVER
+/* A model kept by a server between requests; for a file it is brought up to
+ * date when the file changes, as in watch mode, and for contents sent with a
+ * request when different contents are sent under the same name. */
+typedef struct {
+	char *name;          /**< path of the file, or the name sent with its contents */
+	bool sent;           /**< made from contents sent with a request */
+	watched_t w;         /**< the model and what it was made from */
+	unsigned long used;  /**< the last request it was used for */
+} cached_t;
+
+/* find the cache entry for a name, or empty the least recently used one */
+static cached_t *cache_entry(cached_t *cache, const char *name, bool sent, unsigned long request)
+{
+	assert(cache);
+	assert(name);
+	cached_t *e = &cache[0];
+	for (size_t i = 0; i < DBCC_CACHE_SIZE; i++) {
+		if (cache[i].name && cache[i].sent == sent && !strcmp(cache[i].name, name)) {
+			cache[i].used = request;
+			debug("cached => %s", name);
+			return &cache[i];
+		}
+		if (cache[i].used < e->used)
+			e = &cache[i];
+	}
+	dbc_delete(e->w.dbc);
+	free(e->w.text);
+	free(e->name);
+	memset(e, 0, sizeof(*e));
+	e->name = duplicate(name);
+	e->sent = sent;
+	e->used = request;
+	return e;
+}
+
+static dbc_t *cache_file(cached_t *cache, const char *file, unsigned long request)
+{
+	assert(cache);
+	assert(file);
+	cached_t *e = cache_entry(cache, file, false, request);
+	if (watch_poll(&e->w, file) < 0) {
+		warning("cannot read '%s': %s", file, emsg());
+		return NULL;
+	}
+	return e->w.dbc;
+}
+
+static dbc_t *cache_text(cached_t *cache, const char *name, char *text, unsigned long request)
+{
+	assert(cache);
+	assert(name);
+	assert(text);
+	cached_t *e = cache_entry(cache, name, true, request);
+	if (e->w.text && !strcmp(e->w.text, text))
+		free(text);
+	else
+		watch_update(&e->w, name, text);
+	return e->w.dbc;
+}
+
+/* Parse the options sent with a request, which start at args[1] */
+static int request_options(char **args, int count, unsigned *convert, dbc2c_options_t *copts)
+{
+	assert(args);
+	assert(convert);
+	assert(copts);
+	int r = 0, opt = 0;
+	dbcc_optind   = 1;
+	dbcc_optreset = 1;
+	dbcc_opterr   = 0;
+	while (r == 0 && (opt = dbcc_getopt(count, args, GENERATION_OPTIONS)) != -1)
+		if (generation_option(opt, dbcc_optarg, convert, copts) <= 0)
+			r = -1;
+	dbcc_opterr = 1;
+	if (r < 0 || dbcc_optind != count)
+		return -1;
+	return options_finish(convert, copts);
+}
+
+/* Read one request from a client and answer it; the reply has a "name" and
+ * an "output" record for each file generated and ends with a "status" record
+ * of "ok" or "fail". */
+static void serve_request(int client, cached_t *cache, unsigned long request)
+{
+	assert(cache);
+	static char program[] = "dbcc";
+	const struct timeval timeout = { .tv_sec = DBCC_REQUEST_TIMEOUT_S, .tv_usec = 0 };
+	if (setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+		warning("cannot set a time out for requests: %s", emsg());
+	const int copy = dup(client);
+	FILE *in = fdopen(client, "rb"), *out = copy < 0 ? NULL : fdopen(copy, "wb");
+	if (!in || !out) {
+		warning("cannot read request: %s", emsg());
+		if (in)
+			fclose(in);
+		else
+			close(client);
+		if (out)
+			fclose(out);
+		else if (copy >= 0)
+			close(copy);
+		return;
+	}
+
+	char *args[DBCC_MAX_OPTIONS + 1] = { program };
+	int count = 1;
+	char *file = NULL, *name = NULL, *text = NULL;
+	while (!file && !(name && text)) {
+		char keyword[16];
+		size_t length = 0;
+		char *data = record_read(in, keyword, sizeof(keyword), &length);
+		if (!data)
+			break;
+		if (!strcmp(keyword, "option") && count < DBCC_MAX_OPTIONS) {
+			args[count++] = data;
+		} else if (!strcmp(keyword, "file")) {
+			file = data;
+		} else if (!strcmp(keyword, "name") && !name) {
+			name = data;
+		} else if (!strcmp(keyword, "text") && !text) {
+			text = data;
+		} else {
+			free(data);
+			break;
+		}
+	}
+
+	unsigned convert = 0;
+	dbc2c_options_t copts;
+	options_default(&copts);
+	int r = -1;
+	if (!file && !(name && text)) {
+		warning("request %lu is incomplete", request);
+	} else if (request_options(args, count, &convert, &copts) < 0) {
+		warning("request %lu has invalid options", request);
+	} else {
+		char *source = file ? file : name;
+		dbc_t *dbc = file ? cache_file(cache, file, request) : cache_text(cache, name, text, request);
+		text = NULL; /* now owned by the cache */
+		if (dbc) {
+			reply = out;
+			r = 0;
+			if (copts.use_runtime && (convert & CONVERT_TO_C) && dbc2c_runtimeWrapper(NULL) < 0)
+				r = -1;
+			if (generate(dbc, source, convert, NULL, &copts) < 0)
+				r = -1;
+			reply = NULL;
+		}
+		debug("request %lu %s => %s", request, r < 0 ? "failed" : "done", source);
+	}
+	const char *status = r < 0 ? "fail" : "ok";
+	if (record_write(out, "status", status, strlen(status)) < 0)
+		warning("cannot reply to request %lu", request);
+
+	for (int i = 1; i < count; i++)
+		free(args[i]);
+	free(file);
+	free(name);
+	free(text);
+	free(copts.profile);
+	fclose(out);
+	fclose(in);
+}
+
+/* Server mode; listen on a Unix domain socket and answer generate requests,
+ * one per connection, until SIGINT or SIGTERM. A request has an "option"
+ * record for each of its command line arguments, "-c" or "-P" followed by a
+ * path for example, and then either a "file" record with the path of a DBC
+ * file or a "name" and a "text" record with the name and contents of one.
+ * The compiled grammar and the models of the DBC files most recently asked
+ * for, keyed on path and file stamp or on name and contents, are kept
+ * between requests. */
+static int serve(const char *path)
+{
+	assert(path);
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		warning("socket path is too long: %s", path);
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		warning("cannot make a socket: %s", emsg());
+		return -1;
+	}
+	struct stat st;
+	if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(path); /* left behind by a server that was killed */
+	if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 16) < 0) {
+		warning("cannot listen on '%s': %s", path, emsg());
+		close(fd);
+		return -1;
+	}
+
+	struct sigaction sa; /* without SA_RESTART, so a signal ends 'accept' */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stop;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN); /* a client going away must not end the server */
+
+	cached_t *cache = allocate(sizeof(*cache) * DBCC_CACHE_SIZE);
+	note("serving requests on '%s'", path);
+	int r = 0;
+	for (unsigned long request = 1; !stopping; request++) {
+		const int client = accept(fd, NULL, NULL);
+		if (client < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			warning("accept failed: %s", emsg());
+			r = -1;
+			break;
+		}
+		serve_request(client, cache, request);
+	}
+	note("stopped serving");
+	close(fd);
+	unlink(path);
+	for (size_t i = 0; i < DBCC_CACHE_SIZE; i++) {
+		dbc_delete(cache[i].w.dbc);
+		free(cache[i].w.text);
+		free(cache[i].name);
+	}
+	free(cache);
+	return r;
+}
+
+static int record_option(FILE *out, char opt)
+{
+	assert(out);
+	const char option[] = { '-', opt, '\0' };
+	return record_write(out, "option", option, 2);
+}
+
+/* write a file sent by a server, the run time header only if it has changed
+ * as it is when generated here */
+static int ask_output(const char *outdir, const char *name, const char *contents, size_t length)
+{
+	assert(name);
+	assert(contents);
+	if (!name[0] || strchr(name, '/') || !strcmp(name, ".") || !strcmp(name, "..")) {
+		warning("server sent a bad file name: %s", name);
+		return -1;
+	}
+	char *path = allocate((outdir ? strlen(outdir) + 1 : 0) + strlen(name) + 1);
+	if (outdir) {
+		strcat(path, outdir);
+		strcat(path, "/");
+	}
+	strcat(path, name);
+	output_t o;
+	writer_t *w = output_create(&o, path, !strcmp(name, DBCC_RUNTIME_HEADER));
+	return output_close(&o, writer_write(w, contents, length));
+}
+
+/* Send a request for one file to a server and write out the files it sends
+ * back. -1 is returned if the server could not be asked, a request the
+ * server could not generate the output for only gets a warning, as when
+ * generating here. */
+static int ask_file(const char *path, const char *file, const char *options, const char *profile, const char *outdir)
+{
+	assert(path);
+	assert(file);
+	assert(options);
+	char *absolute = realpath(file, NULL);
+	if (!absolute) {
+		warning("cannot find '%s': %s", file, emsg());
+		return 0;
+	}
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		warning("socket path is too long: %s", path);
+		free(absolute);
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+		warning("cannot connect to '%s': %s", path, emsg());
+		if (fd >= 0)
+			close(fd);
+		free(absolute);
+		return -1;
+	}
+	const int copy = dup(fd);
+	FILE *in = fdopen(fd, "rb"), *out = copy < 0 ? NULL : fdopen(copy, "wb");
+	if (!in || !out)
+		error("cannot open connection to '%s': %s", path, emsg());
+
+	int r = 0;
+	for (size_t i = 0; options[i] && r == 0; i++)
+		r = record_option(out, options[i]);
+	if (profile && r == 0) {
+		char *p = realpath(profile, NULL);
+		if (!p || record_option(out, 'P') < 0 || record_write(out, "option", p, strlen(p)) < 0)
+			r = -1;
+		free(p);
+	}
+	if (r == 0 && (record_write(out, "file", absolute, strlen(absolute)) < 0 || fflush(out) < 0))
+		r = -1;
+
+	char *name = NULL;
+	bool ok = false, answered = false;
+	while (r == 0 && !answered) {
+		char keyword[16];
+		size_t length = 0;
+		char *data = record_read(in, keyword, sizeof(keyword), &length);
+		if (!data) {
+			r = -1;
+		} else if (!strcmp(keyword, "name") && !name) {
+			name = data;
+			continue;
+		} else if (!strcmp(keyword, "output") && name) {
+			if (ask_output(outdir, name, data, length) < 0)
+				r = -1;
+			free(name);
+			name = NULL;
+		} else if (!strcmp(keyword, "status")) {
+			ok = !strcmp(data, "ok");
+			answered = true;
+		} else {
+			r = -1;
+		}
+		free(data);
+	}
+	if (r < 0)
+		warning("bad reply from '%s' for '%s'", path, file);
+	else if (!ok)
+		warning("server could not generate the output for '%s'", file);
+	free(name);
+	free(absolute);
+	fclose(out);
+	fclose(in);
+	return r;
+}
+
+/* Client mode; have the server listening on the socket 'path' generate the
+ * output for each file with the same options, as a drop in replacement for
+ * generating it here */
+static int ask(const char *path, char **files, int count, const char *options, const char *profile, const char *outdir)
+{
+	assert(path);
+	assert(files);
+	assert(options);
+	int r = 0;
+	for (int i = 0; i < count; i++)
+		if (ask_file(path, files[i], options, profile, outdir) < 0)
+			r = -1;
+	return r;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+	log_level_e log_level = get_log_level();
+	unsigned convert = 0; /* set of conversion_type_e */
+	const char *outdir = NULL;
+	const char *server = NULL; /* socket to serve requests on */
+	const char *client = NULL; /* socket of a server to send requests to */
+	const char *profile = NULL;
+	char options[64] = { 0 }; /* generation options given, to send to a server */
+	size_t options_count = 0;
+	bool watch = false;
+	dbc2c_options_t copts;
+	options_default(&copts);
 	int opt = 0;
 
-	while ((opt = dbcc_getopt(argc, argv, "hVvbjgxCNtDpukso:")) != -1) {
+	while ((opt = dbcc_getopt(argc, argv, "hVvgwo:S:a:" GENERATION_OPTIONS)) != -1) {
 		switch (opt) {
 		case 'h':
 			usage(argv[0]);
@@ -176,114 +1130,78 @@ int main(int argc, char **argv)
 			break;
 		case 'g':
 			return printf("DBCC Grammar =>\n%s\n", parse_get_grammar()) < 0;
-		case 'b':
-			convert = CONVERT_TO_BSM;
-			break;
-		case 'j':
-			convert = CONVERT_TO_JSON;
-			break;
-		case 'x':
-			convert = CONVERT_TO_XML;
-			break;
-		case 'C':
-			convert = CONVERT_TO_CSV;
-			break;
-		case 'N':
-			copts.use_id_in_name = false;
-			break;
-		case 't':
-			copts.use_time_stamps = true;
-			debug("using time stamps");
+		case 'S':
+			server = dbcc_optarg;
+			debug("serving requests on %s", server);
 			break;
-		case 'D':
-			copts.use_doubles_for_encoding = true;
-			debug("using doubles for encoding");
+		case 'a':
+			client = dbcc_optarg;
+			debug("sending requests to %s", client);
 			break;
-		case 'p':
-			copts.generate_print = true;
-			debug("generate code for print");
-			break;
-		case 'u':
-			copts.generate_unpack = true;
-			debug("generate code for unpack");
-			break;
-		case 'k':
-			copts.generate_pack = true;
-			debug("generate code for pack");
+		case 'w':
+			watch = true;
+			write_only_if_changed = true;
+			debug("watching input files");
 			break;
 		case 'o':
 			outdir = dbcc_optarg;
 			debug("output directory: %s", outdir);
 			break;
-		case 's':
-			copts.generate_asserts = false;
-			debug("asserts disabled - apparently you think silent corruption is a good thing", outdir);
-			break;
-		default:
-			fprintf(stderr, "invalid options\n");
-			usage(argv[0]);
-			help();
+		default: {
+			const int r = generation_option(opt, dbcc_optarg, &convert, &copts);
+			if (r < 0)
+				error("could not read profile '%s'", dbcc_optarg);
+			if (r == 0) {
+				fprintf(stderr, "invalid options\n");
+				usage(argv[0]);
+				help();
+			} else if (opt == 'P') {
+				profile = dbcc_optarg;
+			} else if (!strchr(options, opt) && options_count < sizeof(options) - 1) {
+				options[options_count++] = opt;
+			}
 			break;
 		}
+		}
 	}
 
-	if (!copts.generate_unpack && !copts.generate_pack && !copts.generate_print) {
-		copts.generate_print  = false;
-		copts.generate_pack   = true;
-		copts.generate_unpack = true;
-	}
+	if (options_finish(&convert, &copts) < 0)
+		error("Cannot use time stamps when specifying CSV option");
 
-	for(int i = dbcc_optind; i < argc; i++) {
-		debug("reading => %s", argv[i]);
-		mpc_ast_t *ast = parse_dbc_file_by_name(argv[i]);
-		if(!ast) {
-			warning("could not parse file '%s'", argv[i]);
-			continue;
-		}
-		if(verbose(LOG_DEBUG))
-			mpc_ast_print(ast);
+	if ((server || client) && !DBCC_SERVER)
+		error("server and client modes need Unix domain sockets");
 
-		dbc_t *dbc = ast2dbc(ast);
+	if (server && watch)
+		error("cannot use both watch and server mode");
 
-		char *outpath = dbcc_basename(argv[i]);
-		if(outdir) {
-			outpath = allocate(strlen(outpath) + strlen(outdir) + 2 /* '/' + '\0'*/);
-			strcat(outpath, outdir);
-			strcat(outpath, "/");
-			strcat(outpath, dbcc_basename(argv[i]));
-		}
+	if (client && (server || watch))
+		error("client mode cannot be combined with server or watch mode");
 
-		int r = 0;
-		switch(convert) {
-		case CONVERT_TO_C:
-			r = dbc2cWrapper(dbc, outpath, dbcc_basename(argv[i]), &copts);
-			break;
-		case CONVERT_TO_XML:
-			r = dbc2xmlWrapper(dbc, outpath, copts.use_time_stamps);
-			break;
-		case CONVERT_TO_CSV:
-			if(copts.use_time_stamps)
-				error("Cannot use time stamps when specifying CSV option");
-			r = dbc2csvWrapper(dbc, outpath);
-			break;
-		case CONVERT_TO_BSM:
-			r = dbc2bsmWrapper(dbc, outpath, copts.use_time_stamps);
-			break;
-		case CONVERT_TO_JSON:
-			r = dbc2jsonWrapper(dbc, outpath, copts.use_time_stamps);
-			break;
-		default:
-			error("invalid conversion type: %d", convert);
-		}
-		if(r < 0)
-			warning("conversion process failed: %u/%u", r, convert);
+	if (watch && dbcc_optind >= argc)
+		error("no files given to watch");
+
+	int r = 0;
+	if (client) {
+#if DBCC_SERVER
+		r = ask(client, argv + dbcc_optind, argc - dbcc_optind, options, profile, outdir);
+#endif
+	} else {
+		if (copts.use_runtime && (convert & CONVERT_TO_C) && dbc2c_runtimeWrapper(outdir) < 0)
+			warning("could not write run time header");
 
-		if(outdir)
-			free(outpath);
-		dbc_delete(dbc);
-		mpc_ast_delete(ast);
+		if (!watch) /* watch mode generates the output for its files itself */
+			for(int i = dbcc_optind; i < argc; i++)
+				process_file(argv[i], convert, outdir, &copts);
 	}
 
-	return 0;
-}
+#if DBCC_SERVER
+	if (server)
+		r = serve(server);
+#endif
+	if (watch)
+		r = watch_files(argv + dbcc_optind, argc - dbcc_optind, convert, outdir, &copts);
 
+	parse_cleanup();
+	free(copts.profile);
+	return r < 0;
+}
@@ -1,6 +1,7 @@
 #include "parse.h"
 #include "util.h"
 #include <assert.h>
+#include <string.h>
 
 static mpc_ast_t *_parse_dbc_string(const char *file_name, const char *string);
 static mpc_ast_t *_parse_dbc_file_by_handle(const char *name, FILE *handle);
@@ -30,6 +31,7 @@ static mpc_ast_t *_parse_dbc_file_by_handle(const char *name, FILE *handle);
 	X(multiplexor,          "multiplexor")\
 	X(signal,               "signal")\
 	X(message,              "message")\
+	X(message_record,       "message_record")\
 	X(messages,             "messages")\
 	X(types,                "types")\
 	X(version,              "version")\
@@ -77,6 +79,7 @@ static const char *dbc_grammar =
 "                        <length> <s>* '@' <s>* <endianess> <s>* <sign> <s>* <y_mx_c> <s>* \n"
 "                        <range> <s>* <unit> <s>* <nodes> <s>* <n> ; \n"
 " message              : \"BO_\" <s>+ <id> <s>+ <name>  <s>* ':' <s>* <dlc> <s>+ <ecu> <s>* <n> <signal>* ; \n"
+" message_record       : /^/ <message> /$/ ; \n"
 " messages             : (<message> <n>*)* ; \n"
 " version              : \"VERSION\" <s> <string> <n>+ ; \n"
 " ecus                 : \"BU_\" <s>* ':' (<ident>|<s>)* <n> ; \n"
@@ -153,6 +156,13 @@ mpc_ast_t *parse_dbc_string(const char *string)
 	return _parse_dbc_string("<string>", string);
 }
 
+mpc_ast_t *parse_dbc_named_string(const char *name, const char *string)
+{
+	assert(name);
+	assert(string);
+	return _parse_dbc_string(name, string);
+}
+
 enum cleanup_length_e
 {
 #define X(CVAR, NAME) _ignore_me_ ## CVAR,
@@ -161,15 +171,22 @@ enum cleanup_length_e
 #undef X
 };
 
-static mpc_ast_t *_parse_dbc_string(const char *file_name, const char *string)
+/* Compiling the grammar costs about as much as parsing a small DBC file, so
+ * it is done once and kept for every file processed by this program. */
+#define X(CVAR, NAME) static mpc_parser_t *parser_ ## CVAR = NULL;
+	X_MACRO_PARSE_VARS
+#undef X
+static bool grammar_compiled = false;
+
+static void parse_compile_grammar(void)
 {
-	assert(file_name);
-	assert(string);
-	#define X(CVAR, NAME) mpc_parser_t *CVAR = mpc_new((NAME));
+	if (grammar_compiled)
+		return;
+	#define X(CVAR, NAME) parser_ ## CVAR = mpc_new((NAME));
 	X_MACRO_PARSE_VARS
 	#undef X
 
-	#define X(CVAR, NAME) CVAR,
+	#define X(CVAR, NAME) parser_ ## CVAR,
 	mpc_err_t *language_error = mpca_lang(MPCA_LANG_WHITESPACE_SENSITIVE, dbc_grammar, X_MACRO_PARSE_VARS NULL);
 	#undef X
 
@@ -178,21 +195,153 @@ static mpc_ast_t *_parse_dbc_string(const char *file_name, const char *string)
 		mpc_err_delete(language_error);
 		exit(EXIT_FAILURE);
 	}
+	grammar_compiled = true;
+}
+
+void parse_cleanup(void)
+{
+	if (!grammar_compiled)
+		return;
+#define X(CVAR, NAME) parser_ ## CVAR,
+	mpc_cleanup(CLEANUP_LENGTH,
+		X_MACRO_PARSE_VARS NULL
+		);
+#undef X
+	grammar_compiled = false;
+}
+
+static mpc_ast_t *_parse_dbc_string(const char *file_name, const char *string)
+{
+	assert(file_name);
+	assert(string);
+	parse_compile_grammar();
 
 	mpc_result_t r;
 	mpc_ast_t *ast = NULL;
-	if (mpc_parse(file_name, string, dbc, &r)) {
+	if (mpc_parse(file_name, string, parser_dbc, &r)) {
 		ast = r.output;
 	} else {
-		mpc_err_print(r.error);
+		mpc_err_print_to(r.error, stderr);
 		mpc_err_delete(r.error);
 	}
+	return ast;
+}
 
-#define X(CVAR, NAME) CVAR,
-	mpc_cleanup(CLEANUP_LENGTH,
-		X_MACRO_PARSE_VARS NULL
-		);
-#undef X
+
+/* Incremental reparsing; the message records (a 'BO_' line and the 'SG_'
+ * lines that follow it) are found by looking at the start of each line, which
+ * is enough to line them up between two versions of a file without parsing
+ * it. */
+typedef struct {
+	const char *start;
+	size_t length;
+} record_t;
+
+static bool line_starts_with(const char *line, const char *keyword)
+{
+	assert(line);
+	assert(keyword);
+	const size_t length = strlen(keyword);
+	return !strncmp(line, keyword, length) && (line[length] == ' ' || line[length] == '\t');
+}
+
+static const char *next_line(const char *line)
+{
+	assert(line);
+	const char *end = strchr(line, '\n');
+	return end ? end + 1 : line + strlen(line);
+}
+
+static record_t *find_message_records(const char *string, size_t *count)
+{
+	assert(string);
+	assert(count);
+	size_t used = 0, size = 64;
+	record_t *records = allocate(sizeof(*records) * size);
+	for (const char *line = string; *line;) {
+		if (!line_starts_with(line, "BO_")) {
+			line = next_line(line);
+			continue;
+		}
+		const char *end = next_line(line);
+		while (*end && line_starts_with(end + strspn(end, " \t"), "SG_"))
+			end = next_line(end);
+		if (used == size) {
+			size *= 2;
+			records = reallocator(records, sizeof(*records) * size);
+		}
+		records[used].start  = line;
+		records[used].length = end - line;
+		used++;
+		line = end;
+	}
+	*count = used;
+	return records;
+}
+
+static mpc_ast_t *parse_message_record(const record_t *record)
+{
+	assert(record);
+	parse_compile_grammar();
+	char *string = allocate(record->length + 1);
+	memcpy(string, record->start, record->length);
+
+	mpc_result_t r;
+	mpc_ast_t *ast = NULL;
+	if (mpc_parse("<record>", string, parser_message_record, &r))
+		ast = r.output;
+	else /* the whole file is reparsed, which reports the error */
+		mpc_err_delete(r.error);
+	free(string);
 	return ast;
 }
 
+static bool same_text(const char *a, size_t a_length, const char *b, size_t b_length)
+{
+	return a_length == b_length && !memcmp(a, b, a_length);
+}
+
+int parse_dbc_update(dbc_t *dbc, const char *previous, const char *current)
+{
+	assert(dbc);
+	assert(previous);
+	assert(current);
+	int r = -1;
+	size_t pn = 0, cn = 0;
+	record_t *p = find_message_records(previous, &pn);
+	record_t *c = find_message_records(current, &cn);
+	if (pn != cn || pn != dbc->message_count)
+		goto end;
+
+	/* everything outside of the message records must be the same */
+	const char *pg = previous, *cg = current;
+	for (size_t i = 0; i <= pn; i++) {
+		const char *pe = i < pn ? p[i].start : pg + strlen(pg);
+		const char *ce = i < cn ? c[i].start : cg + strlen(cg);
+		if (!same_text(pg, pe - pg, cg, ce - cg))
+			goto end;
+		if (i < pn) {
+			pg = p[i].start + p[i].length;
+			cg = c[i].start + c[i].length;
+		}
+	}
+
+	int reparsed = 0;
+	for (size_t i = 0; i < pn; i++) {
+		if (same_text(p[i].start, p[i].length, c[i].start, c[i].length))
+			continue;
+		mpc_ast_t *ast = parse_message_record(&c[i]);
+		if (!ast)
+			goto end;
+		const int u = dbc_replace_message(dbc, i, mpc_ast_get_child(ast, "message|>"));
+		mpc_ast_delete(ast);
+		if (u < 0)
+			goto end;
+		reparsed++;
+	}
+	r = reparsed;
+end:
+	free(p);
+	free(c);
+	return r;
+}
@@ -6,12 +6,23 @@ extern "C" {
 #endif
 
 #include "mpc.h"
+#include "can.h"
 #include <stdio.h>
 
 mpc_ast_t *parse_dbc_file_by_name(const char *name);
 mpc_ast_t *parse_dbc_file_by_handle(FILE *handle);
 mpc_ast_t *parse_dbc_string(const char *string);
+mpc_ast_t *parse_dbc_named_string(const char *name, const char *string);
 const char *parse_get_grammar(void);
+void parse_cleanup(void);
+
+/* Bring 'dbc', made from the DBC file 'previous', up to date with the edited
+ * file 'current' by reparsing only the message records that differ between
+ * the two. This returns the number of messages reparsed, or -1 if the edit
+ * cannot be applied in place (other records changed, a message gained a
+ * signal or changed its identifier, or a syntax error); the whole file must
+ * then be parsed again and 'dbc' discarded, as it may be partially updated. */
+int parse_dbc_update(dbc_t *dbc, const char *previous, const char *current);
 
 #ifdef __cplusplus
 }
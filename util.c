@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L /* stat, nanosleep */
 #include "util.h"
 #include <assert.h>
 #include <errno.h>
@@ -5,6 +6,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 static log_level_e log_level = LOG_NOTES;
 
@@ -153,6 +158,69 @@ fail:
 	return NULL;
 }
 
+/* returns true only if the file 'name' exists and contains exactly 'b' */
+bool file_contents_equal(const char *name, const char *b, size_t length)
+{
+	assert(name);
+	assert(b);
+	char chunk[4096];
+	bool equal = true;
+	FILE *f = fopen(name, "rb");
+	if (!f)
+		return false;
+	size_t got = 0;
+	while (equal && (got = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+		if (got > length || memcmp(chunk, b, got)) {
+			equal = false;
+		} else {
+			b += got;
+			length -= got;
+		}
+	}
+	if (ferror(f) || length)
+		equal = false;
+	fclose(f);
+	return equal;
+}
+
+int file_stamp(const char *name, file_stamp_t *stamp)
+{
+	assert(name);
+	assert(stamp);
+	struct stat s;
+	errno = 0;
+	if (stat(name, &s) < 0)
+		return -1;
+	stamp->modified = s.st_mtime;
+#if defined(_WIN32)
+	stamp->nanoseconds = 0;
+#elif defined(__APPLE__)
+	stamp->nanoseconds = s.st_mtimespec.tv_nsec;
+#else
+	stamp->nanoseconds = s.st_mtim.tv_nsec;
+#endif
+	stamp->size     = s.st_size;
+	return 0;
+}
+
+bool file_stamp_equal(const file_stamp_t *a, const file_stamp_t *b)
+{
+	assert(a);
+	assert(b);
+	return a->modified == b->modified && a->nanoseconds == b->nanoseconds && a->size == b->size;
+}
+
+void sleep_ms(unsigned ms)
+{
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000l };
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+		;
+#endif
+}
+
 /* Stolen from musl-libc!
  * <https://www.musl-libc.org/download.html>
  *
@@ -8,9 +8,16 @@ extern "C" {
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
 
 #define UNUSED(X) ((void)(X))
 
+typedef struct {
+	time_t modified;  /**< last modification time */
+	long nanoseconds; /**< sub-second part of 'modified', 0 if unavailable */
+	uint64_t size;    /**< size in bytes */
+} file_stamp_t;
+
 typedef enum {
 	LOG_NO_MESSAGES,
 	LOG_ERRORS,
@@ -37,6 +44,10 @@ char *duplicate(const char *s);
 void *reallocator(void *p, size_t n);
 char *slurp(FILE *f);
 char *dbcc_basename(char *s);
+bool file_contents_equal(const char *name, const char *b, size_t length);
+int file_stamp(const char *name, file_stamp_t *stamp);
+bool file_stamp_equal(const file_stamp_t *a, const file_stamp_t *b);
+void sleep_ms(unsigned ms);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,231 @@
+/**@file writer.c
+ * @brief Buffered output shared by the code and data file generators
+ * @copyright Richard James Howe
+ * @license MIT */
+#include "writer.h"
+#include "util.h"
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+writer_t *writer_new(FILE *out)
+{
+	assert(out);
+	writer_t *w = allocate(sizeof(*w));
+	w->out  = out;
+	w->size = WRITER_BUFFER_SIZE;
+	w->buf  = allocate(w->size);
+	return w;
+}
+
+/* A writer that keeps all of its output in memory, see 'writer_contents' */
+writer_t *writer_new_memory(void)
+{
+	writer_t *w = allocate(sizeof(*w));
+	w->size = WRITER_BUFFER_SIZE;
+	w->buf  = allocate(w->size);
+	return w;
+}
+
+int writer_flush(writer_t *w)
+{
+	assert(w);
+	if (w->error)
+		return -1;
+	if (!w->out)
+		return 0;
+	errno = 0;
+	if (w->used && fwrite(w->buf, 1, w->used, w->out) != w->used) {
+		warning("problem writing to FILE* <%p>: %s", w->out, emsg());
+		w->error = true;
+		return -1;
+	}
+	w->used = 0;
+	return 0;
+}
+
+/* Flush any remaining output and free the writer, the FILE* is not closed.
+ * Returns -1 if any write made through this writer failed. */
+int writer_delete(writer_t *w)
+{
+	if (!w)
+		return 0;
+	const int r = writer_flush(w);
+	free(w->buf);
+	free(w);
+	return r;
+}
+
+bool writer_error(writer_t *w)
+{
+	assert(w);
+	return w->error;
+}
+
+const char *writer_contents(writer_t *w, size_t *length)
+{
+	assert(w);
+	assert(length);
+	assert(!w->out);
+	*length = w->used;
+	return w->buf;
+}
+
+/* Make room for at least 'length' more bytes, flushing if there is a FILE*
+ * to flush to and growing the buffer if that is not enough. */
+static int writer_reserve(writer_t *w, size_t length)
+{
+	assert(w);
+	if (length <= (w->size - w->used))
+		return 0;
+	if (w->out && writer_flush(w) < 0)
+		return -1;
+	if (length > (w->size - w->used)) {
+		size_t size = w->size;
+		while (length > (size - w->used))
+			size *= 2;
+		w->buf  = reallocator(w->buf, size);
+		w->size = size;
+	}
+	return 0;
+}
+
+int writer_write(writer_t *w, const char *s, size_t length)
+{
+	assert(w);
+	assert(s);
+	if (w->error)
+		return -1;
+	if (writer_reserve(w, length) < 0)
+		return -1;
+	memcpy(w->buf + w->used, s, length);
+	w->used += length;
+	return length;
+}
+
+int writer_puts(writer_t *w, const char *s)
+{
+	assert(s);
+	return writer_write(w, s, strlen(s));
+}
+
+int writer_putc(writer_t *w, int c)
+{
+	assert(w);
+	if (w->error)
+		return -1;
+	if (writer_reserve(w, 1) < 0)
+		return -1;
+	w->buf[w->used++] = c;
+	return (unsigned char)c;
+}
+
+int writer_vprintf(writer_t *w, const char *fmt, va_list ap)
+{
+	assert(w);
+	assert(fmt);
+	if (w->error)
+		return -1;
+	va_list copy;
+	va_copy(copy, ap);
+	const size_t left = w->size - w->used;
+	int r = vsnprintf(w->buf + w->used, left, fmt, copy);
+	va_end(copy);
+	if (r < 0)
+		goto fail;
+	if ((size_t)r < left) {
+		w->used += r;
+		return r;
+	}
+	/* Did not fit, the partial output is discarded as 'used' has not
+	 * moved, make room and format again. */
+	if (writer_reserve(w, (size_t)r + 1) < 0)
+		return -1;
+	r = vsnprintf(w->buf + w->used, w->size - w->used, fmt, ap);
+	if (r < 0)
+		goto fail;
+	w->used += r;
+	return r;
+fail:
+	warning("formatting failed for '%s'", fmt);
+	w->error = true;
+	return -1;
+}
+
+int writer_printf(writer_t *w, const char *fmt, ...)
+{
+	assert(w);
+	assert(fmt);
+	va_list ap;
+	va_start(ap, fmt);
+	const int r = writer_vprintf(w, fmt, ap);
+	va_end(ap);
+	return r;
+}
+
+int writer_indent(writer_t *w, unsigned depth)
+{
+	static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+	int r = 0;
+	while (depth && r >= 0) {
+		const unsigned n = depth < (sizeof(tabs) - 1) ? depth : (sizeof(tabs) - 1);
+		r = writer_write(w, tabs, n);
+		depth -= n;
+	}
+	return r < 0 ? -1 : 0;
+}
+
+int writer_unsigned(writer_t *w, uint64_t u)
+{
+	char b[24];
+	size_t i = sizeof(b);
+	do {
+		b[--i] = '0' + (u % 10);
+		u /= 10;
+	} while (u);
+	return writer_write(w, b + i, sizeof(b) - i);
+}
+
+int writer_signed(writer_t *w, int64_t s)
+{
+	if (s >= 0)
+		return writer_unsigned(w, s);
+	if (writer_putc(w, '-') < 0)
+		return -1;
+	const int r = writer_unsigned(w, -(uint64_t)s);
+	return r < 0 ? -1 : r + 1;
+}
+
+/* Equivalent to printf("%0*"PRIx64, min_digits, u), lower case digits. */
+int writer_hex(writer_t *w, uint64_t u, unsigned min_digits)
+{
+	static const char digits[] = "0123456789abcdef";
+	char b[24];
+	size_t i = sizeof(b);
+	assert(min_digits <= 16);
+	do {
+		b[--i] = digits[u & 0xF];
+		u >>= 4;
+	} while (u);
+	while ((sizeof(b) - i) < min_digits)
+		b[--i] = '0';
+	return writer_write(w, b + i, sizeof(b) - i);
+}
+
+/* Equivalent to printf("%g", d). Most scaling factors, offsets and ranges in
+ * a DBC file are small integers, those are printed without calling into the C
+ * library, everything else goes through snprintf. */
+int writer_double(writer_t *w, double d)
+{
+	if (d > -1e6 && d < 1e6 && d == (double)(int64_t)d && !(d == 0.0 && signbit(d)))
+		return writer_signed(w, (int64_t)d);
+	char b[32];
+	const int r = snprintf(b, sizeof(b), "%g", d);
+	if (r < 0 || (size_t)r >= sizeof(b)) {
+		w->error = true;
+		return -1;
+	}
+	return writer_write(w, b, r);
+}
@@ -0,0 +1,62 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define WRITER_BUFFER_SIZE (64u * 1024u)
+
+/* lets the compiler check the format strings given to 'writer_printf' */
+#ifdef __GNUC__
+#define WRITER_PRINTF(FMT, ARGS) __attribute__((format(printf, FMT, ARGS)))
+#else
+#define WRITER_PRINTF(FMT, ARGS)
+#endif
+
+/* A buffered output writer used by all of the output modules (2c.c, 2xml.c,
+ * ...). Output is accumulated in a large buffer and handed to the underlying
+ * FILE* in big chunks, instead of going through stdio for every character.
+ *
+ * A writer made with 'writer_new_memory' has no FILE*, its buffer grows to
+ * hold everything written to it instead.
+ *
+ * The error state is sticky: once a write fails every later operation on the
+ * writer does nothing and returns -1, so the emitters only need to check the
+ * result of 'writer_delete' (or 'writer_error') at the end. */
+typedef struct {
+	FILE *out;    /**< where output is flushed to, NULL if in memory */
+	char *buf;    /**< output buffer */
+	size_t used;  /**< bytes currently in buffer */
+	size_t size;  /**< size of buffer */
+	bool error;   /**< set on first failure, never cleared */
+} writer_t;
+
+writer_t *writer_new(FILE *out);
+writer_t *writer_new_memory(void);
+const char *writer_contents(writer_t *w, size_t *length);
+int writer_delete(writer_t *w);
+int writer_flush(writer_t *w);
+bool writer_error(writer_t *w);
+int writer_write(writer_t *w, const char *s, size_t length);
+int writer_puts(writer_t *w, const char *s);
+int writer_putc(writer_t *w, int c);
+int writer_printf(writer_t *w, const char *fmt, ...) WRITER_PRINTF(2, 3);
+int writer_vprintf(writer_t *w, const char *fmt, va_list ap) WRITER_PRINTF(2, 0);
+int writer_indent(writer_t *w, unsigned depth);
+int writer_unsigned(writer_t *w, uint64_t u);
+int writer_signed(writer_t *w, int64_t s);
+int writer_hex(writer_t *w, uint64_t u, unsigned min_digits);
+int writer_double(writer_t *w, double d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif